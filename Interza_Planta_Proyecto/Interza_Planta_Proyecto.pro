@@ -9,14 +9,20 @@ SOURCES += \
     productioncontroller.cpp \
     ipc_common.cpp \
     station_child.cpp \
+    dispatcher.cpp \
+    sim_config.cpp \
+    service_time.cpp \
     threadmanager.cpp
 
 HEADERS += \
     mainwindow.h \
     station_child.h \
+    dispatcher.h \
     transportbeltwidget.h \
     productioncontroller.h \
     ipc_common.h \
+    sim_config.h \
+    service_time.h \
     threadmanager.h \
     product.h
 
@@ -26,3 +32,29 @@ FORMS += \
 RESOURCES += resources.qrc
 
 unix: LIBS += -pthread
+
+# Ejecutable `station` sin Qt (estaciones y despachador). Se construye junto
+# al de la GUI, que lo lanza con posix_spawn; `make station` lo genera solo.
+STATION_SOURCES = \
+    $$PWD/station_main.cpp \
+    $$PWD/ipc_common.cpp \
+    $$PWD/station_child.cpp \
+    $$PWD/dispatcher.cpp \
+    $$PWD/service_time.cpp
+station.target = station
+station.depends = $$STATION_SOURCES $$PWD/ipc_common.h $$PWD/station_child.h $$PWD/dispatcher.h \
+                  $$PWD/service_time.h
+station.commands = $$QMAKE_CXX -std=c++17 -O2 -I$$PWD $$STATION_SOURCES -o station -lrt -pthread
+QMAKE_EXTRA_TARGETS += station
+PRE_TARGETDEPS += station
+QMAKE_CLEAN += station
+OTHER_FILES += station_main.cpp
+
+# Microbenchmark de coherencia de caché (sin Qt): `make coherence_bench`.
+# No se construye con la GUI.
+coherence_bench.target = coherence_bench
+coherence_bench.depends = $$PWD/coherence_bench.cpp $$PWD/ipc_common.h
+coherence_bench.commands = $$QMAKE_CXX -std=c++17 -O2 -I$$PWD $$PWD/coherence_bench.cpp -o coherence_bench -pthread
+QMAKE_EXTRA_TARGETS += coherence_bench
+QMAKE_CLEAN += coherence_bench
+OTHER_FILES += coherence_bench.cpp
@@ -0,0 +1,97 @@
+#include "ipc_common.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <time.h>
+
+// Microbenchmark sin Qt del tráfico de coherencia entre estaciones:
+//   coherence_bench [--stations=N] [--iters=N]
+// Cada hilo hace de una estación con tiempo de trabajo cero y repite lo que
+// escribe station_run en cada producto: abre el seqlock, marca done, anota
+// el producto, lo cierra y mira la palabra de pausa. Se compara la
+// disposición anterior (arreglos paralelos de int, todas las estaciones en
+// las mismas líneas de caché) con los StationBlock alineados de ShmState.
+// Con un solo núcleo los hilos se turnan y no hay tráfico entre núcleos:
+// las dos disposiciones deberían dar lo mismo.
+
+// Disposición anterior: un campo de cada estación junto al de la siguiente
+struct PackedStations {
+    std::atomic<uint32_t> seq[MAX_STATIONS];
+    int done[MAX_STATIONS];
+    ProductInfo product[MAX_STATIONS];
+    std::atomic<int32_t> paused[MAX_STATIONS];
+};
+
+// Una vuelta de la estación i sobre sus propios campos
+static void packed_step(PackedStations* p, int i, int64_t k) {
+    p->seq[i].fetch_add(1, std::memory_order_acquire);
+    p->done[i] = 1;
+    p->product[i].productId = k;
+    p->seq[i].fetch_add(1, std::memory_order_release);
+    if (p->paused[i].load(std::memory_order_relaxed)) return;
+    p->done[i] = 0;
+}
+
+static void block_step(StationBlock* blocks, int i, int64_t k) {
+    StationBlock& st = blocks[i];
+    WorkerSlot& w = st.workers[0];
+    w.lock.seq.fetch_add(1, std::memory_order_acquire);
+    w.done = 1;
+    w.product.productId = k;
+    w.lock.seq.fetch_add(1, std::memory_order_release);
+    if (st.paused.load(std::memory_order_relaxed)) return;
+    w.done = 0;
+}
+
+static double now_s() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// ns por vuelta (cada una de las n estaciones da un paso), todas a la vez
+template <class Step>
+static double run(int n, int64_t iters, Step step) {
+    std::vector<std::thread> threads;
+    std::atomic<int> ready{0};
+    for (int i = 0; i < n; i++) {
+        threads.emplace_back([&, i]() {
+            ready.fetch_add(1);
+            while (ready.load() < n) std::this_thread::yield();
+            for (int64_t k = 1; k <= iters; k++) step(i, k);
+        });
+    }
+    while (ready.load() < n) std::this_thread::yield();
+    double start = now_s();
+    for (std::thread& t : threads) t.join();
+    return (now_s() - start) * 1e9 / iters;
+}
+
+int main(int argc, char* argv[]) {
+    int stations = DEFAULT_STATIONS;
+    int64_t iters = 20000000;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--stations=", 11) == 0) stations = atoi(argv[i] + 11);
+        else if (strncmp(argv[i], "--iters=", 8) == 0) iters = atoll(argv[i] + 8);
+    }
+    if (stations < 1) stations = 1;
+    if (stations > MAX_STATIONS) stations = MAX_STATIONS;
+
+    PackedStations* packed = new PackedStations();
+    StationBlock* blocks = static_cast<StationBlock*>(aligned_alloc(CACHE_LINE, sizeof(StationBlock) * stations));
+    memset(static_cast<void*>(blocks), 0, sizeof(StationBlock) * stations);
+
+    double p = run(stations, iters, [&](int i, int64_t k) { packed_step(packed, i, k); });
+    double b = run(stations, iters, [&](int i, int64_t k) { block_step(blocks, i, k); });
+    printf("stations=%d iters=%lld cpus=%u\n", stations, (long long)iters, std::thread::hardware_concurrency());
+    printf("  packed arrays:    %7.2f ns/vuelta\n", p);
+    printf("  StationBlock:     %7.2f ns/vuelta\n", b);
+    printf("  speedup:          %7.2fx\n", b > 0 ? p / b : 0.0);
+
+    free(blocks);
+    delete packed;
+    return 0;
+}
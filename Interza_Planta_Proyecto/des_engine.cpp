@@ -0,0 +1,426 @@
+#include "des_engine.h"
+#include "ipc_common.h"
+
+#include <algorithm>
+#include <queue>
+
+namespace {
+
+struct Product {
+    int64_t id;
+    uint64_t t_in;  // instante de despacho (ns simulados)
+};
+
+enum DesEventKind : uint32_t {
+    DES_DONE = 0,   // un trabajador terminó su producto
+    DES_PAUSE,
+    DES_RESUME
+};
+
+// Evento con marca de tiempo; seq desempata en orden de creación para que
+// la corrida sea determinista con la misma semilla
+struct Event {
+    uint64_t t;
+    uint64_t seq;
+    uint32_t kind;
+    uint32_t station;  // índice global
+    uint32_t worker;
+    bool operator>(const Event& o) const { return t != o.t ? t > o.t : seq > o.seq; }
+};
+
+enum WorkerState { W_IDLE = 0, W_BUSY, W_BLOCKED };
+
+struct Worker {
+    Product product;
+    uint64_t since;  // inicio del estado actual
+    int state;
+    int station;     // índice global de su estación
+    ServiceRng rng;  // flujo propio del trabajador
+};
+
+struct Station {
+    int line;
+    int idx;
+    int worker_count;
+    int first_worker;        // índice en Sim::workers
+    int paused;              // > 0 mientras alguna pausa esté activa
+    const ServiceModel* service;
+    // Cola de entrada (anillo de capacidad depth; sin buffer, el producto
+    // entra y sale en el mismo instante)
+    int depth;
+    std::vector<Product> queue;
+    uint32_t q_head = 0;
+    uint32_t q_count = 0;
+    uint64_t q_since = 0;    // último cambio de q_count
+    uint64_t q_area = 0;     // integral de q_count (productos × ns)
+    int cards = 0;           // tarjetas kanban libres
+    // Rutas de salida (como StationBlock::routes) y turno de la bifurcación
+    int routes[MAX_ROUTES];
+    int route_count = 0;
+    uint32_t route_turn = 0;
+    // Trabajadores libres (pila) y trabajadores de las estaciones que la
+    // alimentan bloqueados esperando lugar en esta (FIFO)
+    std::vector<int> idle;
+    std::vector<int> waiting;
+    uint32_t w_head = 0;
+    uint32_t w_count = 0;
+    uint64_t busy_ns = 0;
+    uint64_t blocked_ns = 0;
+};
+
+// Histograma de tiempos en línea con precisión relativa de 1/1024: exacto
+// hasta 2048 ms y luego 1024 casillas por potencia de dos
+const int LEAD_EXACT = 2048;
+const int LEAD_SUB = 1024;
+const int LEAD_BUCKETS = LEAD_EXACT + 54 * LEAD_SUB;
+
+int lead_bucket(uint64_t ms) {
+    if (ms < (uint64_t)LEAD_EXACT) return (int)ms;
+    int shift = 63 - __builtin_clzll(ms) - 10;
+    return LEAD_EXACT + (shift - 1) * LEAD_SUB + (int)((ms >> shift) - LEAD_SUB);
+}
+
+uint64_t lead_bucket_ms(int b) {
+    if (b < LEAD_EXACT) return (uint64_t)b;
+    int shift = (b - LEAD_EXACT) / LEAD_SUB + 1;
+    return (uint64_t)((b - LEAD_EXACT) % LEAD_SUB + LEAD_SUB) << shift;
+}
+
+class Sim {
+public:
+    explicit Sim(const DesConfig& c) : cfg(c) {}
+    DesResult run();
+
+private:
+    const DesConfig& cfg;
+    std::vector<Station> st;
+    std::vector<Worker> workers;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> heap;
+    uint64_t now = 0;
+    uint64_t seq = 0;
+    int64_t nextId = 1;
+    uint64_t leadSumNs = 0;
+    std::vector<uint64_t> leadHist;
+    std::vector<int> lineWip;
+    int totalWip = 0;
+    uint64_t wipSince = 0;
+    double wipArea = 0;      // integral de totalWip (productos × ns)
+    DesResult res;
+
+    Station& at(int line, int idx) { return st[line * cfg.stations + idx]; }
+    void schedule(uint64_t t, uint32_t kind, int station, int worker) {
+        heap.push(Event{t, seq++, kind, (uint32_t)station, (uint32_t)worker});
+    }
+    uint64_t serviceNs(const Station& s, Worker& w) {
+        return (uint64_t)(service_sample_ms(*s.service, &w.rng) * 1e6);
+    }
+    void setState(Worker& w, Station& s, int state);
+    void queueChanged(Station& s) {
+        s.q_area += s.q_count * (now - s.q_since);
+        s.q_since = now;
+    }
+    void wipChanged(int line, int delta) {
+        wipArea += (double)totalWip * (now - wipSince);
+        wipSince = now;
+        totalWip += delta;
+        lineWip[line] += delta;
+    }
+    void push(Station& s, const Product& p);
+    Product pop(Station& s);
+    // Sin buffer solo hay lugar si un trabajador libre lo toma en el acto
+    bool full(const Station& s) const {
+        if (s.depth > 0) return s.q_count == (uint32_t)s.depth;
+        return s.paused || s.q_count >= s.idle.size();
+    }
+    // Además del lugar, la política de liberación: tarjeta kanban libre y,
+    // en la estación 0 con CONWIP, línea por debajo del tope. Como el
+    // despachador real, no se libera nada a una línea con la entrada pausada.
+    bool canAccept(const Station& s) const {
+        if (full(s)) return false;
+        if (s.idx == 0 && s.paused) return false;
+        if (cfg.release == RELEASE_KANBAN && s.cards <= 0) return false;
+        if (s.idx == 0 && cfg.release == RELEASE_CONWIP && lineWip[s.line] >= cfg.wip_limit) return false;
+        return true;
+    }
+    void startWork(Station& s);
+    bool spaceFreed(Station& s);
+    void left(Station& s);
+    void finish(Station& s, int w);
+    void complete(Station& s, const Product& p);
+};
+
+// Cambia el estado de un trabajador acumulando el tiempo del anterior
+void Sim::setState(Worker& w, Station& s, int state) {
+    if (w.state == W_BUSY) s.busy_ns += now - w.since;
+    else if (w.state == W_BLOCKED) s.blocked_ns += now - w.since;
+    w.state = state;
+    w.since = now;
+}
+
+void Sim::push(Station& s, const Product& p) {
+    queueChanged(s);
+    if (cfg.release == RELEASE_KANBAN) s.cards--;  // el producto lleva la tarjeta de s
+    s.queue[(s.q_head + s.q_count) % s.queue.size()] = p;
+    s.q_count++;
+}
+
+Product Sim::pop(Station& s) {
+    queueChanged(s);
+    Product p = s.queue[s.q_head];
+    s.q_head = (s.q_head + 1) % s.queue.size();
+    s.q_count--;
+    return p;
+}
+
+// Los trabajadores libres toman productos de la cola mientras haya y la
+// estación no esté pausada (como la fase 1 de station_child). Sin buffer,
+// cada trabajador libre pide además una entrega directa.
+void Sim::startWork(Station& s) {
+    for (;;) {
+        while (!s.paused && !s.idle.empty() && s.q_count > 0) {
+            int w = s.idle.back();
+            s.idle.pop_back();
+            Worker& wk = workers[w];
+            wk.product = pop(s);
+            setState(wk, s, W_BUSY);
+            schedule(now + serviceNs(s, wk), DES_DONE, (int)(&s - st.data()), w);
+            if (s.depth > 0) spaceFreed(s);
+        }
+        if (s.depth > 0 || !spaceFreed(s)) return;
+    }
+}
+
+// Se liberó un lugar en la cola de s (o una tarjeta, o cupo CONWIP): en la
+// estación 0 el despachador la vuelve a llenar; en las demás entra el
+// producto del primer trabajador que esperaba lugar en s (de cualquiera de
+// las estaciones que la alimentan), que queda libre para seguir. Devuelve false si s no admite nada todavía o no
+// había nada que entregar.
+bool Sim::spaceFreed(Station& s) {
+    if (!canAccept(s)) return false;
+    if (s.idx == 0) {
+        push(s, Product{nextId++, now});
+        res.dispatched++;
+        wipChanged(s.line, +1);
+        return true;
+    }
+    if (s.w_count == 0) return false;
+    int w = s.waiting[s.w_head];
+    s.w_head = (s.w_head + 1) % s.waiting.size();
+    s.w_count--;
+    Station& prev = st[workers[w].station];
+    push(s, workers[w].product);
+    setState(workers[w], prev, W_IDLE);
+    prev.idle.push_back(w);
+    left(prev);
+    startWork(prev);
+    return true;
+}
+
+// Un producto salió de s: con kanban su tarjeta queda libre y puede entrar
+// el siguiente (sin buffer, startWork ya lo pide por cada trabajador libre)
+void Sim::left(Station& s) {
+    if (cfg.release != RELEASE_KANBAN) return;
+    s.cards++;
+    if (s.depth > 0 && spaceFreed(s)) startWork(s);
+}
+
+void Sim::complete(Station& s, const Product& p) {
+    uint64_t lead = now - p.t_in;
+    res.completed++;
+    res.line_completed[s.line]++;
+    leadSumNs += lead;
+    leadHist[lead_bucket(lead / 1000000ull)]++;
+    wipChanged(s.line, -1);
+    // CONWIP: la salida de un producto deja entrar otro
+    if (cfg.release == RELEASE_CONWIP) {
+        Station& entry = at(s.line, 0);
+        if (spaceFreed(entry)) startWork(entry);
+    }
+}
+
+// Fin del trabajo: una estación de salida entrega el producto; las demás
+// lo pasan a una sucesora o quedan bloqueadas hasta que haya lugar. La
+// elección es la de station_child: en una bifurcación, por turnos y, si la
+// del turno no admite, la primera de las otras que sí; si ninguna, se
+// espera en la del turno.
+void Sim::finish(Station& s, int w) {
+    Worker& wk = workers[w];
+    if (s.route_count == 0) {
+        complete(s, wk.product);
+    } else {
+        int n = s.route_count;
+        uint32_t turn = n > 1 ? s.route_turn++ : 0;
+        Station* next = nullptr;
+        for (int k = 0; k < n && !next; k++) {
+            Station& cand = at(s.line, s.routes[(turn + k) % n]);
+            if (canAccept(cand)) next = &cand;
+        }
+        if (!next) {
+            Station& wait = at(s.line, s.routes[turn % n]);
+            setState(wk, s, W_BLOCKED);
+            wait.waiting[(wait.w_head + wait.w_count) % wait.waiting.size()] = w;
+            wait.w_count++;
+            return;
+        }
+        push(*next, wk.product);
+        startWork(*next);
+    }
+    setState(wk, s, W_IDLE);
+    s.idle.push_back(w);
+    left(s);
+    startWork(s);
+}
+
+DesResult Sim::run() {
+    int total = cfg.lines * cfg.stations;
+    res.line_completed.assign(cfg.lines, 0);
+    lineWip.assign(cfg.lines, 0);
+    leadHist.assign(LEAD_BUCKETS, 0);
+
+    st.resize(total);
+    for (int i = 0; i < total; i++) {
+        Station& s = st[i];
+        int idx = i % cfg.stations;
+        s.line = i / cfg.stations;
+        s.idx = idx;
+        s.worker_count = idx < (int)cfg.workers.size() ? cfg.workers[idx] : cfg.workers.back();
+        s.service = idx < (int)cfg.service.size() ? &cfg.service[idx] : &cfg.service.back();
+        s.first_worker = (int)workers.size();
+        s.paused = 0;
+        s.depth = idx < (int)cfg.buffer_depth.size() ? cfg.buffer_depth[idx] : cfg.buffer_depth.back();
+        s.queue.resize(s.depth > 0 ? s.depth : s.worker_count);
+        int cards = idx < (int)cfg.kanban.size() ? cfg.kanban[idx] : cfg.kanban.back();
+        s.cards = cards > 0 ? cards : s.worker_count;
+        const std::vector<int>& next = cfg.routes[idx];
+        s.route_count = (int)next.size();
+        for (int k = 0; k < s.route_count; k++) s.routes[k] = next[k];
+        for (int w = 0; w < s.worker_count; w++) {
+            s.idle.push_back(s.first_worker + s.worker_count - 1 - w);  // el trabajador 0 primero
+            workers.push_back(Worker{Product{0, 0}, 0, W_IDLE, i, ServiceRng{}});
+            service_rng_stream(&workers.back().rng, cfg.seed, rng_stream_id(i, w));
+        }
+    }
+
+    // Cada estación puede tener esperando a todos los trabajadores de las
+    // que la alimentan
+    for (const Station& s : st) {
+        for (int k = 0; k < s.route_count; k++) {
+            Station& to = at(s.line, s.routes[k]);
+            to.waiting.resize(to.waiting.size() + s.worker_count);
+        }
+    }
+
+    for (const DesPause& p : cfg.pauses) {
+        if (p.line < 0 || p.line >= cfg.lines || p.station < 0 || p.station >= cfg.stations) continue;
+        int idx = p.line * cfg.stations + p.station;
+        schedule((uint64_t)(p.from_s * 1e9), DES_PAUSE, idx, 0);
+        schedule((uint64_t)(p.to_s * 1e9), DES_RESUME, idx, 0);
+    }
+
+    // Colas de entrada llenas desde el inicio, como con el despachador real
+    for (int l = 0; l < cfg.lines; l++) {
+        Station& entry = at(l, 0);
+        while (spaceFreed(entry)) {}
+        startWork(entry);
+    }
+
+    uint64_t end = (uint64_t)(cfg.duration_s * 1e9);
+    bool limitReached = false;
+    while (!heap.empty()) {
+        Event ev = heap.top();
+        if (ev.t > end) break;
+        heap.pop();
+        now = ev.t;
+        res.events++;
+        Station& s = st[ev.station];
+        switch (ev.kind) {
+        case DES_DONE:
+            finish(s, (int)ev.worker);
+            break;
+        case DES_PAUSE:
+            s.paused++;
+            break;
+        case DES_RESUME:
+            if (s.paused > 0 && --s.paused == 0) {
+                // resumeStation despierta al despachador: vuelve a llenar la entrada
+                if (s.idx == 0) while (spaceFreed(s)) {}
+                startWork(s);
+            }
+            break;
+        }
+        if (cfg.max_products && res.completed >= cfg.max_products) {
+            limitReached = true;
+            break;
+        }
+    }
+    if (!limitReached) now = end;
+
+    // Cerrar los intervalos en curso
+    res.sim_time_s = now / 1e9;
+    res.utilization.assign(total, 0.0);
+    res.blocked.assign(total, 0.0);
+    res.queue_mean.assign(total, 0.0);
+    wipChanged(0, 0);
+    if (now > 0) res.wip_mean = wipArea / now;
+    for (int i = 0; i < total; i++) {
+        Station& s = st[i];
+        for (int w = s.first_worker; w < s.first_worker + s.worker_count; w++) setState(workers[w], s, W_IDLE);
+        queueChanged(s);
+        if (now > 0) res.queue_mean[i] = (double)s.q_area / now;
+        double capacity = (double)now * s.worker_count;
+        if (capacity > 0) {
+            res.utilization[i] = s.busy_ns / capacity;
+            res.blocked[i] = s.blocked_ns / capacity;
+        }
+    }
+
+    if (res.completed) {
+        res.lead_mean_s = leadSumNs / 1e9 / res.completed;
+        uint64_t targets[3] = {(res.completed * 50 + 99) / 100, (res.completed * 95 + 99) / 100,
+                               (res.completed * 99 + 99) / 100};
+        double* outs[3] = {&res.lead_p50_s, &res.lead_p95_s, &res.lead_p99_s};
+        uint64_t seen = 0;
+        int k = 0;
+        for (int b = 0; b < LEAD_BUCKETS; b++) {
+            if (!leadHist[b]) continue;
+            seen += leadHist[b];
+            while (k < 3 && seen >= targets[k]) *outs[k++] = lead_bucket_ms(b) / 1e3;
+            res.lead_max_s = lead_bucket_ms(b) / 1e3;
+        }
+    }
+    return res;
+}
+
+} // namespace
+
+DesResult des_run(const DesConfig& cfg) {
+    DesConfig c = cfg;
+    if (c.lines < 1) c.lines = 1;
+    if (c.stations < 1) c.stations = 1;
+    if (c.buffer_depth.empty()) c.buffer_depth = {1};
+    for (int& d : c.buffer_depth) d = std::max(0, d);
+    if (c.workers.empty()) c.workers = {1};
+    if (c.service.empty()) c.service = {service_default()};
+    for (int& w : c.workers) w = std::max(1, std::min(MAX_WORKERS, w));  // un flujo por trabajador
+    if (c.kanban.empty()) c.kanban = {0};
+    if (c.wip_limit < 1) {
+        c.wip_limit = 0;
+        for (int i = 0; i < c.stations; i++) c.wip_limit += i < (int)c.workers.size() ? c.workers[i] : c.workers.back();
+    }
+    // Rutas válidas: solo hacia adelante y hasta MAX_ROUTES por estación
+    if (c.routes.empty()) {
+        for (int i = 0; i < c.stations; i++) {
+            c.routes.push_back(i + 1 < c.stations ? std::vector<int>{i + 1} : std::vector<int>());
+        }
+    }
+    c.routes.resize(c.stations);
+    for (int i = 0; i < c.stations; i++) {
+        std::vector<int>& next = c.routes[i];
+        next.erase(std::remove_if(next.begin(), next.end(),
+                                  [&](int to) { return to <= i || to >= c.stations; }),
+                   next.end());
+        if ((int)next.size() > MAX_ROUTES) next.resize(MAX_ROUTES);
+    }
+    Sim sim(c);
+    return sim.run();
+}
@@ -0,0 +1,69 @@
+#ifndef DES_ENGINE_H
+#define DES_ENGINE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "service_time.h"
+
+// Simulación por eventos discretos del mismo modelo de línea que corren las
+// estaciones reales (station_child.cpp): colas de entrada acotadas, K
+// trabajadores por estación, tiempo de trabajo según su ServiceModel, entrega
+// bloqueante a la estación siguiente del grafo de rutas (directa si la cola
+// es de 0), pausas y las políticas de liberación del despachador (push,
+// CONWIP, kanban). El reloj es virtual: cada evento avanza el tiempo
+// simulado sin dormir, tan rápido como da la CPU.
+
+// Intervalo de pausa de una estación, en segundos simulados
+struct DesPause {
+    int line = 0;
+    int station = 0;
+    double from_s = 0;
+    double to_s = 0;
+};
+
+struct DesConfig {
+    int lines = 1;
+    int stations = 5;
+    std::vector<int> buffer_depth = {1};  // cola de entrada por estación (0 = entrega directa)
+    int release = 0;                    // ReleasePolicy
+    int wip_limit = 0;                  // CONWIP por línea (0 = un producto por trabajador)
+    std::vector<int> kanban = {0};      // tarjetas por estación (0 = una por trabajador)
+    std::vector<int> workers = {1};     // por estación; las que faltan usan el último
+    std::vector<ServiceModel> service = {service_default()};  // por estación, misma regla
+    // Sucesoras de cada estación (índices dentro de la línea, mayores que el
+    // propio); vacío = cadena lineal. Sin sucesoras = estación de salida.
+    std::vector<std::vector<int>> routes;
+    double duration_s = 3600;           // tiempo simulado
+    uint64_t max_products = 0;          // 0 = sin límite (solo duration_s)
+    // Semilla de la corrida: cada trabajador usa el mismo flujo que tendría
+    // en las estaciones reales (rng_stream_id), así que sus tiempos no
+    // dependen del orden de los eventos ni del resto de la configuración
+    uint64_t seed = 1;
+    std::vector<DesPause> pauses;
+};
+
+// Resultados en tiempo simulado
+struct DesResult {
+    double sim_time_s = 0;
+    uint64_t dispatched = 0;
+    uint64_t completed = 0;
+    uint64_t events = 0;
+    std::vector<uint64_t> line_completed;
+    // Tiempo en línea (despacho → salida por una estación final), en segundos
+    double lead_mean_s = 0;
+    double lead_p50_s = 0;
+    double lead_p95_s = 0;
+    double lead_p99_s = 0;
+    double lead_max_s = 0;
+    // Por estación (índice global línea * estaciones + estación): fracción
+    // del tiempo de sus trabajadores procesando y bloqueados esperando lugar
+    std::vector<double> utilization;
+    std::vector<double> blocked;
+    std::vector<double> queue_mean;     // ocupación media de su cola de entrada
+    double wip_mean = 0;                // productos dentro de las líneas, media en el tiempo
+};
+
+DesResult des_run(const DesConfig& cfg);
+
+#endif // DES_ENGINE_H
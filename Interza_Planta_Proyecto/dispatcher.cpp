@@ -0,0 +1,129 @@
+#include "dispatcher.h"
+#include "ipc_common.h"
+
+#include <unistd.h>
+#include <cstdio>
+
+// Carga estimada de una línea: productos dentro × tiempo de ciclo de su
+// estación más lenta (cuello de botella). El ciclo de una estación es el
+// promedio medido de sus trabajadores dividido por cuántos son. Una línea
+// sin medir vale 0 para que reciba trabajo y se mida cuanto antes.
+static uint64_t line_load(const ShmState* s, int line) {
+    uint64_t bottleneck = 0;
+    for (int i = 0; i < s->header.station_count; i++) {
+        const StationBlock& st = s->station(line, i);
+        uint64_t sum = 0;
+        int measured = 0;
+        for (int w = 0; w < st.worker_count; w++) {
+            uint64_t c = st.workers[w].cycle_ewma_ns.load(std::memory_order_relaxed);
+            if (c) { sum += c; measured++; }
+        }
+        if (!measured) continue;
+        uint64_t c = sum / measured / st.worker_count;
+        if (c > bottleneck) bottleneck = c;
+    }
+    int wip = s->line(line).wip.load(std::memory_order_relaxed);
+    return (uint64_t)(wip + 1) * bottleneck;
+}
+
+// La política de liberación deja entrar un producto más a la línea
+static bool release_allows(const ShmState* s, int line) {
+    switch (s->header.release_policy) {
+    case RELEASE_CONWIP:
+        return s->line(line).wip.load(std::memory_order_relaxed) < s->header.wip_limit;
+    case RELEASE_KANBAN:
+        return s->station(line, 0).card_sem.count.load() > 0;
+    default:
+        return true;
+    }
+}
+
+// Elige la línea que recibe el próximo producto según la política. Solo son
+// candidatas las líneas en marcha, con la estación 0 sin pausar, con lugar
+// en su cola de entrada y que la política de liberación admita. Los empates
+// se resuelven por turno a partir de rrNext. Devuelve -1 si ninguna línea
+// admite un producto ahora.
+static int pick_line(ShmState* s, int policy, int rrNext) {
+    int lines = s->header.line_count;
+    int best = -1;
+    uint64_t bestKey = 0;
+    for (int k = 0; k < lines; k++) {
+        int l = (rrNext + k) % lines;
+        const StationBlock& entry = s->station(l, 0);
+        if (!s->line(l).running.load(std::memory_order_acquire) || entry.paused.load() || entry.space_sem.count.load() <= 0) continue;
+        if (!release_allows(s, l)) continue;
+
+        uint64_t key;
+        switch (policy) {
+        case DISPATCH_SHORTEST_QUEUE:
+            // Cola de entrada más corta; a igual cola, menos productos dentro
+            key = ((uint64_t)ring_size(&entry.input) << 32) |
+                  (uint32_t)s->line(l).wip.load(std::memory_order_relaxed);
+            break;
+        case DISPATCH_LEAST_LOADED:
+            key = line_load(s, l);
+            break;
+        default:
+            return l;  // round-robin: la primera disponible desde el turno
+        }
+        if (best < 0 || key < bestKey) {
+            best = l;
+            bestKey = key;
+        }
+    }
+    return best;
+}
+
+// Despachador: fuente de productos nuevos delante de las líneas.
+// Asigna cada producto a una línea y lo encola en su estación 0; cuando
+// ninguna línea tiene lugar duerme hasta que una estación 0 libere uno (o,
+// con CONWIP, hasta que salga un producto de la línea).
+void dispatcher_run() {
+    ShmState* s = ipc_state();
+    int rrNext = 0;
+
+    while (s->header.running) {
+        // Leer la palabra antes de buscar: si algo cambia durante la
+        // búsqueda, futex_wait_word vuelve de inmediato
+        int32_t seen = s->header.dispatch_wake.load();
+
+        int line = pick_line(s, s->header.dispatch_policy.load(), rrNext);
+        if (line < 0) {
+            futex_wait_word(&s->header.dispatch_wake, seen);
+            continue;
+        }
+        rrNext = (line + 1) % s->header.line_count;
+
+        // El despachador es el único que consume estos créditos (y las
+        // tarjetas de la estación 0): si había lugar al elegir, sigue habiéndolo
+        StationBlock& entry = s->station(line, 0);
+        bool kanban = s->header.release_policy == RELEASE_KANBAN;
+        if (kanban && !fsem_try_wait(&entry.card_sem)) continue;
+        if (!fsem_try_wait(&entry.space_sem)) {
+            if (kanban) fsem_post(&entry.card_sem);
+            continue;
+        }
+
+        ProductInfo p;
+        p.productId = ipc_next_product_id(s, line);
+        s->line(line).wip.fetch_add(1);
+        s->line(line).dispatched.fetch_add(1);
+        // A la bitácora antes de publicarlo: el EV_ACQUIRED del trabajador
+        // que lo tome siempre queda después en la secuencia
+        journal_append(&s->journal, EV_DISPATCHED, line, 0, p.productId);
+        ring_push(&entry.input, p);
+        fsem_post(&entry.stage_sem);
+    }
+}
+
+extern "C" void _dispatcher_entry() {
+    if (!open_ipc()) {
+        fprintf(stderr, "Dispatcher: cannot open ipc\n");
+        _exit(1);
+    }
+
+    dispatcher_run();
+
+    close_ipc();
+    _exit(0);
+}
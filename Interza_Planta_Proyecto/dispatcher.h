@@ -0,0 +1,10 @@
+#ifndef DISPATCHER_H
+#define DISPATCHER_H
+
+// Ciclo del despachador sobre la IPC ya abierta; vuelve al detener la simulación
+void dispatcher_run();
+
+// Punto de entrada del proceso despachador (backend fork)
+extern "C" void _dispatcher_entry();
+
+#endif // DISPATCHER_H
@@ -0,0 +1,264 @@
+#include "bench.h"
+#include "ipc_common.h"
+#include "station_child.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Vueltas de ida y vuelta para medir la latencia de entrega
+#define HANDOFF_ROUNDS 100000
+
+// PSS de un proceso en kB (0 si el kernel no expone smaps_rollup)
+static long pss_kb(pid_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/smaps_rollup", (int)pid);
+    FILE* f = fopen(path, "r");
+    if (!f) return 0;
+    char line[256];
+    long kb = 0;
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "Pss:", 4) == 0) {
+            kb = strtol(line + 4, nullptr, 10);
+            break;
+        }
+    }
+    fclose(f);
+    return kb;
+}
+
+// ns por entrega: dos semáforos en ping-pong entre este proceso y otro
+// trabajador (un hijo de fork() o un hilo)
+static double bench_handoff(ShmState* s, bool fork) {
+    FutexSem* ping = &s->station(0).workers[0].ack_sem;
+    FutexSem* pong = &s->station(0).workers[1].ack_sem;
+    auto echo = [=]() {
+        for (int i = 0; i < HANDOFF_ROUNDS; i++) {
+            fsem_wait(ping);
+            fsem_post(pong);
+        }
+    };
+
+    uint64_t t0 = ipc_now_ns();
+    pid_t pid = -1;
+    std::thread thread;
+    if (fork) {
+        pid = ::fork();
+        if (pid == 0) {
+            echo();
+            _exit(0);
+        }
+    } else {
+        thread = std::thread(echo);
+    }
+    for (int i = 0; i < HANDOFF_ROUNDS; i++) {
+        fsem_post(ping);
+        fsem_wait(pong);
+    }
+    if (fork) waitpid(pid, nullptr, 0);
+    else thread.join();
+    return (double)(ipc_now_ns() - t0) / HANDOFF_ROUNDS / 2;
+}
+
+struct BackendResult {
+    double start_ms = 0;   // lanzar n trabajadores hasta que todos corren
+    long pss_kb = 0;       // memoria de todos los procesos involucrados
+    double handoff_ns = 0;
+};
+
+// Una línea de n estaciones con un trabajador cada una, sin despachador:
+// los trabajadores arrancan, siembran su generador y esperan producto
+static BackendResult bench_backend(bool fork, int n) {
+    BackendResult r;
+    if (!create_ipc(1, n, 1, fork)) {
+        fprintf(stderr, "bench: no se pudo crear la IPC\n");
+        return r;
+    }
+    ShmState* s = ipc_state();
+    s->header.auto_ack = 1;
+    s->header.run_seed = 1;
+
+    r.handoff_ns = bench_handoff(s, fork);
+
+    std::vector<pid_t> pids;
+    std::vector<std::thread> threads;
+    uint64_t t0 = ipc_now_ns();
+    for (int i = 0; i < n; i++) {
+        if (fork) {
+            pid_t pid = ::fork();
+            if (pid == 0) _child_entry(0, i, 0);
+            pids.push_back(pid);
+        } else {
+            threads.emplace_back(station_run, 0, i, 0);
+        }
+    }
+    // Corriendo = ya sembró su generador (lo primero que hace station_run)
+    for (int i = 0; i < n; i++) {
+        const uint64_t* rs = s->station(i).rngs[0].rng.s;
+        while (!(rs[0] | rs[1] | rs[2] | rs[3])) sched_yield();
+    }
+    r.start_ms = (ipc_now_ns() - t0) / 1e6;
+
+    r.pss_kb = pss_kb(getpid());
+    for (pid_t pid : pids) r.pss_kb += pss_kb(pid);
+
+    // Detener como wakeLine: cada trabajador duerme en su stage_sem
+    s->header.running = 0;
+    for (int i = 0; i < n; i++) {
+        fsem_post(&s->station(i).stage_sem);
+        futex_wake_word(&s->station(i).paused);
+    }
+    for (pid_t pid : pids) waitpid(pid, nullptr, 0);
+    for (std::thread& t : threads) t.join();
+    destroy_ipc();
+    return r;
+}
+
+static void bench_backends() {
+    printf("backends: arranque, memoria y entrega (%d vueltas)\n", HANDOFF_ROUNDS);
+    printf("  %-8s %8s %10s %12s %12s\n", "backend", "stations", "start ms", "PSS total MB", "handoff ns");
+    for (int fork = 1; fork >= 0; fork--) {
+        for (int n : {16, 64, 256}) {
+            BackendResult r = bench_backend(fork, n);
+            printf("  %-8s %8d %10.1f %12.1f %12.0f\n", fork ? "fork" : "thread", n, r.start_ms,
+                   r.pss_kb / 1024.0, r.handoff_ns);
+            fflush(stdout);
+        }
+    }
+}
+
+// Acceso al estado compartido: antes cada lectura hacía shm_open + mmap +
+// munmap + close; ahora es el puntero del mapeo persistente (ipc_state)
+static void bench_mapping() {
+    const int rounds = 100000;
+    if (!create_ipc(1, DEFAULT_STATIONS, 1, true)) {
+        fprintf(stderr, "bench: no se pudo crear la IPC\n");
+        return;
+    }
+    size_t size = ipc_layout_size(1, DEFAULT_STATIONS);
+    volatile int sink = 0;
+
+    uint64_t t0 = ipc_now_ns();
+    for (int i = 0; i < rounds; i++) {
+        int fd = shm_open(ipc_name(), O_RDWR, 0666);
+        if (fd < 0) break;
+        void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p != MAP_FAILED) {
+            sink = static_cast<ShmState*>(p)->station(0).paused.load();
+            munmap(p, size);
+        }
+        ::close(fd);
+    }
+    double perOpen = (double)(ipc_now_ns() - t0) / rounds;
+
+    t0 = ipc_now_ns();
+    for (int i = 0; i < rounds; i++) sink = ipc_state()->station(0).paused.load();
+    double perPointer = (double)(ipc_now_ns() - t0) / rounds;
+    (void)sink;
+    destroy_ipc();
+
+    printf("mapping: acceso al estado compartido (%d accesos)\n", rounds);
+    printf("  shm_open+mmap+munmap+close  %10.0f ns/acceso  (4 syscalls + fallo de página + TLB)\n", perOpen);
+    printf("  mapeo persistente           %10.1f ns/acceso  (0 syscalls)\n", perPointer);
+    // Tasas de ejemplo: en reposo (sondeo cada 150 ms, hilos de mantenimiento)
+    // y con ACKs de una o de varias líneas en marcha
+    for (int rate : {30, 300, 3000}) {
+        printf("  a %4d accesos/s: %6d syscalls/s y %.2f ms de CPU por segundo menos\n", rate, rate * 4,
+               rate * (perOpen - perPointer) / 1e6);
+    }
+}
+
+// Entrega entre procesos con los semáforos con nombre de antes (sem_open)
+// frente a FutexSem dentro de ShmState, y el costo de cada ACK de la GUI,
+// que antes abría y cerraba el semáforo en cada llamada
+static void bench_futex() {
+    const int rounds = HANDOFF_ROUNDS;
+    char pingName[64], pongName[64];
+    snprintf(pingName, sizeof(pingName), "/sim_bench_ping_%d", (int)getpid());
+    snprintf(pongName, sizeof(pongName), "/sim_bench_pong_%d", (int)getpid());
+    sem_t* ping = sem_open(pingName, O_CREAT | O_EXCL, 0600, 0);
+    sem_t* pong = sem_open(pongName, O_CREAT | O_EXCL, 0600, 0);
+    if (ping == SEM_FAILED || pong == SEM_FAILED || !create_ipc(1, DEFAULT_STATIONS, 1, true)) {
+        fprintf(stderr, "bench: no se pudieron crear los semáforos\n");
+        sem_unlink(pingName);
+        sem_unlink(pongName);
+        return;
+    }
+
+    uint64_t t0 = ipc_now_ns();
+    pid_t pid = fork();
+    if (pid == 0) {
+        for (int i = 0; i < rounds; i++) {
+            sem_wait(ping);
+            sem_post(pong);
+        }
+        _exit(0);
+    }
+    for (int i = 0; i < rounds; i++) {
+        sem_post(ping);
+        sem_wait(pong);
+    }
+    waitpid(pid, nullptr, 0);
+    double named = (double)(ipc_now_ns() - t0) / rounds / 2;
+
+    double futex = bench_handoff(ipc_state(), true);
+
+    // Un ACK: antes sem_open + sem_post + sem_close; ahora un fsem_post
+    t0 = ipc_now_ns();
+    for (int i = 0; i < rounds; i++) {
+        sem_t* ack = sem_open(pingName, 0);
+        if (ack == SEM_FAILED) break;
+        sem_post(ack);
+        sem_close(ack);
+    }
+    double ackNamed = (double)(ipc_now_ns() - t0) / rounds;
+    FutexSem* ack = &ipc_state()->station(0).workers[0].ack_sem;
+    t0 = ipc_now_ns();
+    for (int i = 0; i < rounds; i++) fsem_post(ack);
+    double ackFutex = (double)(ipc_now_ns() - t0) / rounds;
+
+    sem_close(ping);
+    sem_close(pong);
+    sem_unlink(pingName);
+    sem_unlink(pongName);
+    destroy_ipc();
+
+    printf("futex: entrega entre dos procesos (%d vueltas) y costo de un ACK\n", rounds);
+    printf("  sem_t con nombre   %8.0f ns/entrega   ACK (sem_open+post+close) %8.0f ns\n", named, ackNamed);
+    printf("  FutexSem           %8.0f ns/entrega   ACK (fsem_post)           %8.0f ns\n", futex, ackFutex);
+}
+
+int run_bench(const char* which, int ballastMb) {
+    bool all = !which || !*which || strcmp(which, "all") == 0;
+    if (!all && strcmp(which, "backends") != 0 && strcmp(which, "mapping") != 0 &&
+        strcmp(which, "futex") != 0) {
+        fprintf(stderr, "bench: medición desconocida '%s' (mapping, futex, backends, all)\n", which);
+        return 1;
+    }
+
+    // Propio de la corrida: no pisar la memoria de una simulación en marcha
+    char name[64];
+    snprintf(name, sizeof(name), "/sim_shm_bench_%d", (int)getpid());
+    ipc_set_name(name);
+
+    size_t ballastBytes = (size_t)(ballastMb > 0 ? ballastMb : 0) << 20;
+    char* ballast = static_cast<char*>(malloc(ballastBytes ? ballastBytes : 1));
+    for (size_t k = 0; k < ballastBytes; k += 4096) ((volatile char*)ballast)[k] = 1;
+    printf("bench: pid %d, %d MB de memoria propia tocada\n", (int)getpid(), ballastMb);
+
+    if (all || strcmp(which, "mapping") == 0) bench_mapping();
+    if (all || strcmp(which, "futex") == 0) bench_futex();
+    if (all || strcmp(which, "backends") == 0) bench_backends();
+
+    free(ballast);
+    close_ipc();
+    return 0;
+}
@@ -0,0 +1,15 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// Mediciones reproducibles de la capa de IPC (interza_headless --bench):
+//   mapping   costo de acceder al estado con shm_open/mmap en cada lectura
+//             frente al mapeo persistente
+//   futex     latencia de entrega y costo de un ACK con semáforos con
+//             nombre (sem_open) frente a FutexSem en ShmState
+//   backends  arranque, memoria (PSS) y latencia de entrega con fork() y
+//             con hilos, para 16, 64 y 256 estaciones
+// ballastMb reserva y toca esa cantidad de memoria antes de medir, para que
+// el proceso que se duplica con fork() pese como la GUI de Qt.
+int run_bench(const char* which, int ballastMb);
+
+#endif // BENCH_H
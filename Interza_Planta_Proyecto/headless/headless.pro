@@ -0,0 +1,32 @@
+# Simulación sin interfaz gráfica: solo QtCore, para servidores y mediciones.
+# Reutiliza el controlador, la IPC y la lógica de las estaciones de la GUI.
+TEMPLATE = app
+TARGET = interza_headless
+CONFIG += c++17 console
+CONFIG -= app_bundle
+QT = core
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    headless_main.cpp \
+    bench.cpp \
+    ../productioncontroller.cpp \
+    ../ipc_common.cpp \
+    ../station_child.cpp \
+    ../dispatcher.cpp \
+    ../sim_config.cpp \
+    ../des_engine.cpp \
+    ../service_time.cpp
+
+HEADERS += \
+    bench.h \
+    ../productioncontroller.h \
+    ../ipc_common.h \
+    ../station_child.h \
+    ../dispatcher.h \
+    ../sim_config.h \
+    ../des_engine.h \
+    ../service_time.h
+
+unix: LIBS += -pthread -lrt
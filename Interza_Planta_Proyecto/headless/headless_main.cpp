@@ -0,0 +1,341 @@
+#include "productioncontroller.h"
+#include "sim_config.h"
+#include "ipc_common.h"
+#include "des_engine.h"
+#include "bench.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+
+#include <algorithm>
+#include <cstdio>
+#include <poll.h>
+#include <signal.h>
+
+// Corrida sin GUI: arranca las líneas con la configuración de la línea de
+// comandos (las mismas opciones que la GUI más --duration=SEG y --verbose),
+// las estaciones no esperan ACK y al terminar se imprime el throughput y la
+// distribución del tiempo en línea (despacho → salida por una estación final).
+//
+// Con --des no se arranca ningún proceso: el mismo modelo corre en el motor
+// de eventos discretos (des_engine) con reloj virtual. --duration son
+// segundos simulados (una hora si falta), --products=N corta al completar N
+// y --pause=L:E:DESDE-HASTA (línea y estación desde 1, segundos) pausa una
+// estación; se puede repetir. --sweep=DESDE-HASTA repite la corrida variando
+// el límite de la política de liberación (tope CONWIP, tarjetas kanban de
+// cada estación o, con push, el buffer) e imprime throughput contra WIP.
+//
+// --bench[=mapping|futex|backends|all] no simula: mide la capa de IPC (ver bench.h) e
+// imprime una tabla; --ballast=MB fija la memoria propia (100 por omisión).
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void on_signal(int) {
+    g_stop = 1;
+}
+
+static const char* backend_name(int backend) {
+    switch (backend) {
+    case BACKEND_SPAWN:  return "spawn";
+    case BACKEND_FORK:   return "fork";
+    case BACKEND_THREAD: return "thread";
+    default:             return "?";
+    }
+}
+
+// Percentil q (0..1) de una muestra ordenada, en milisegundos
+static double percentile_ms(const QVector<quint64> &sorted, double q) {
+    if (sorted.isEmpty()) return 0.0;
+    int k = qBound(0, (int)(q * (sorted.size() - 1) + 0.5), sorted.size() - 1);
+    return sorted[k] / 1e6;
+}
+
+static QString int_list(const std::vector<int> &values) {
+    QStringList parts;
+    for (int v : values) parts << QString::number(v);
+    return parts.join(',');
+}
+
+// " routes=1:2,2:3,3:4,3:5" (estaciones desde 1) con un grafo propio; nada
+// con la cadena lineal
+static QString route_list(const std::vector<std::vector<int>> &routes) {
+    QStringList edges;
+    for (size_t i = 0; i < routes.size(); i++) {
+        for (int to : routes[i]) edges << QString("%1:%2").arg(i + 1).arg(to + 1);
+    }
+    return routes.empty() ? QString() : " routes=" + edges.join(',');
+}
+
+// Una corrida por valor del límite de liberación; la misma semilla en todas
+// para que las diferencias sean solo del límite
+static int run_sweep(DesConfig des, int from, int to) {
+    printf("config: lines=%d stations=%d buffer=%s release=%s engine=des seed=%llu%s\n", des.lines,
+           des.stations, qPrintable(int_list(des.buffer_depth)), release_policy_name(des.release),
+           (unsigned long long)des.seed, qPrintable(route_list(des.routes)));
+    printf("%6s %10s %12s %10s %10s\n", des.release == RELEASE_PUSH ? "buffer" : "limit",
+           "wip", "throughput/h", "lead s", "lead p95");
+    for (int n = from; n <= to; n++) {
+        if (des.release == RELEASE_CONWIP) des.wip_limit = n;
+        else if (des.release == RELEASE_KANBAN) des.kanban = {n};
+        else des.buffer_depth = {n};
+        DesResult r = des_run(des);
+        printf("%6d %10.2f %12.1f %10.2f %10.2f\n", n, r.wip_mean,
+               r.sim_time_s > 0 ? r.completed / r.sim_time_s * 3600 : 0.0, r.lead_mean_s, r.lead_p95_s);
+    }
+    return 0;
+}
+
+// Corrida con reloj virtual; imprime los resultados en tiempo simulado
+static int run_des(const SimConfig &config, const QStringList &args) {
+    DesConfig des;
+    des.lines = config.lines;
+    des.stations = config.stations;
+    des.buffer_depth = config.buffer_depth;
+    des.workers = config.workers;
+    des.service = config.service;
+    des.release = config.release_policy;
+    des.wip_limit = config.wip_limit;
+    des.kanban = config.kanban;
+    des.routes = config.routes;
+    des.duration_s = config.duration_s > 0 ? config.duration_s : 3600;
+    des.seed = config.seed ? config.seed : sim_random_seed();
+    int sweepFrom = -1, sweepTo = -1;
+    for (const QString &arg : args) {
+        if (arg.startsWith("--sweep=")) {
+            QStringList range = arg.mid(8).split('-');
+            sweepFrom = range.value(0).toInt();
+            sweepTo = range.size() > 1 ? range[1].toInt() : sweepFrom;
+            int lo = des.release == RELEASE_PUSH ? 0 : 1;
+            int hi = des.release == RELEASE_PUSH ? MAX_BUFFER_DEPTH
+                                                 : des.release == RELEASE_KANBAN ? MAX_KANBAN_CARDS : 100000;
+            sweepFrom = qBound(lo, sweepFrom, hi);
+            sweepTo = qBound(sweepFrom, sweepTo, hi);
+        } else if (arg.startsWith("--products=")) {
+            des.max_products = arg.mid(11).toULongLong();
+        } else if (arg.startsWith("--pause=")) {
+            // L:E:DESDE-HASTA
+            QStringList parts = arg.mid(8).split(':');
+            QStringList range = parts.value(2).split('-');
+            if (parts.size() != 3 || range.size() != 2) {
+                fprintf(stderr, "headless: pausa inválida %s\n", qPrintable(arg));
+                return 1;
+            }
+            DesPause p;
+            p.line = parts[0].toInt() - 1;
+            p.station = parts[1].toInt() - 1;
+            p.from_s = range[0].toDouble();
+            p.to_s = range[1].toDouble();
+            des.pauses.push_back(p);
+        }
+    }
+    if (sweepFrom >= 0) return run_sweep(des, sweepFrom, sweepTo);
+
+    QElapsedTimer wall;
+    wall.start();
+    DesResult r = des_run(des);
+    double wallS = wall.nsecsElapsed() / 1e9;
+
+    printf("config: lines=%d stations=%d buffer=%s release=%s engine=des seed=%llu%s\n", des.lines,
+           des.stations, qPrintable(int_list(des.buffer_depth)), release_policy_name(des.release),
+           (unsigned long long)des.seed, qPrintable(route_list(des.routes)));
+    printf("simulated: %.3f s  (wall %.3f s, %.0f events, %.2f M products/s of CPU)\n",
+           r.sim_time_s, wallS, (double)r.events, wallS > 0 ? r.completed / wallS / 1e6 : 0.0);
+    printf("dispatched: %llu  completed: %llu  throughput: %.3f /s  (%.0f /h simulated)\n",
+           (unsigned long long)r.dispatched, (unsigned long long)r.completed,
+           r.sim_time_s > 0 ? r.completed / r.sim_time_s : 0.0,
+           r.sim_time_s > 0 ? r.completed / r.sim_time_s * 3600 : 0.0);
+    if (r.line_completed.size() > 1) {
+        for (size_t l = 0; l < r.line_completed.size(); l++) {
+            printf("  line %zu: %llu\n", l + 1, (unsigned long long)r.line_completed[l]);
+        }
+    }
+    printf("wip: mean %.2f products\n", r.wip_mean);
+    if (r.completed) {
+        printf("lead time s: mean %.2f  p50 %.2f  p95 %.2f  p99 %.2f  max %.2f\n",
+               r.lead_mean_s, r.lead_p50_s, r.lead_p95_s, r.lead_p99_s, r.lead_max_s);
+    }
+    for (size_t i = 0; i < r.utilization.size(); i++) {
+        printf("  L%zu E%zu: busy %5.1f%%  blocked %5.1f%%  queue %.2f\n", i / des.stations + 1,
+               i % des.stations + 1, r.utilization[i] * 100, r.blocked[i] * 100, r.queue_mean[i]);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    SimConfig config;
+    parse_sim_args(argc, argv, config);
+    config.auto_ack = true;  // nadie anima ni confirma los productos
+    bool verbose = app.arguments().contains("--verbose");
+    if (app.arguments().contains("--des")) return run_des(config, app.arguments());
+    int ballastMb = 100;
+    for (const QString &arg : app.arguments()) {
+        if (arg.startsWith("--ballast=")) ballastMb = arg.mid(10).toInt();
+    }
+    for (const QString &arg : app.arguments()) {
+        if (arg == "--bench" || arg.startsWith("--bench=")) return run_bench(qPrintable(arg.mid(8)), ballastMb);
+    }
+
+    ProductionController controller;
+    controller.setConfig(config);
+    controller.setStationExecutable(QCoreApplication::applicationDirPath() + "/station");
+    QObject::connect(&controller, &ProductionController::logMessage, [verbose](const QString &msg) {
+        if (verbose) fprintf(stderr, "%s\n", qPrintable(msg));
+    });
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    if (!controller.initializeIPC()) {
+        fprintf(stderr, "headless: no se pudo inicializar la IPC\n");
+        return 1;
+    }
+    ShmState *s = ipc_state();
+    // Al inicio y sin buffer: una corrida cortada también se puede repetir
+    fprintf(stderr, "headless: seed=%llu\n", (unsigned long long)controller.runSeed());
+
+    JournalCursor cursor;
+    QHash<qint64, quint64> enteredAt;  // productId -> instante en que se despachó
+    QVector<quint64> leadTimes;        // ns por producto completado
+    QVector<quint64> completedPerLine(s->header.line_count, 0);
+    quint64 dispatched = 0;
+
+    // Ocupación de cada cola de entrada ponderada por tiempo, reconstruida
+    // con los eventos que la llenan (despacho, transferencia) y la vacían
+    // (un trabajador toma el producto); igual el WIP de cada línea, entre
+    // el despacho y la salida. Las llegadas se anotan antes de publicar el
+    // producto: en la secuencia de la bitácora nadie toma algo que no llegó.
+    struct QueueStat {
+        int count = 0;
+        uint64_t last = 0;   // no retrocede: dos escritores casi simultáneos
+                             // pueden cruzar sus marcas de tiempo
+        double area = 0;     // productos × ns
+    };
+    QVector<QueueStat> queues(s->total_stations());
+    QVector<QueueStat> lineWip(s->header.line_count);
+    auto track = [](QueueStat &q, int delta, uint64_t t) {
+        if (t > q.last) {
+            q.area += (double)q.count * (t - q.last);
+            q.last = t;
+        }
+        q.count += delta;
+    };
+    auto queueDelta = [&](int i, int delta, uint64_t t) { track(queues[i], delta, t); };
+
+    auto drainJournal = [&]() {
+        JournalRecord events[256];
+        int n;
+        while ((n = journal_read(&s->journal, &cursor, events, 256)) > 0) {
+            for (int k = 0; k < n; k++) {
+                const JournalRecord &ev = events[k];
+                int i = ev.line * s->header.station_count + ev.station;
+                if (ev.type == EV_DISPATCHED) {
+                    dispatched++;
+                    enteredAt.insert(ev.productId, ev.timestamp_ns);
+                    queueDelta(i, +1, ev.timestamp_ns);
+                    track(lineWip[ev.line], +1, ev.timestamp_ns);
+                } else if (ev.type == EV_TRANSFERRED) {
+                    queueDelta(ev.line * s->header.station_count + ev.target, +1, ev.timestamp_ns);
+                } else if (ev.type == EV_ACQUIRED) {
+                    queueDelta(i, -1, ev.timestamp_ns);
+                } else if (ev.type == EV_COMPLETED) {
+                    completedPerLine[ev.line]++;
+                    track(lineWip[ev.line], -1, ev.timestamp_ns);
+                    auto it = enteredAt.find(ev.productId);
+                    if (it != enteredAt.end()) {
+                        leadTimes.append(ev.timestamp_ns - it.value());
+                        enteredAt.erase(it);
+                    }
+                }
+            }
+        }
+    };
+
+    uint64_t start = ipc_now_ns();
+    // --duration es tiempo simulado: a 10× dura una décima en reloj real
+    uint64_t end = config.duration_s > 0
+                       ? start + (uint64_t)(config.duration_s * 1e9 * 100 / config.speed_x100) : 0;
+    if (!controller.startAllLines()) {
+        fprintf(stderr, "headless: no se pudieron arrancar las líneas\n");
+        controller.stopAllLines();
+        controller.destroyIPC();
+        return 1;
+    }
+
+    // Despertar con los avisos de las estaciones; el timeout acota la
+    // espera para respetar la duración y atender Ctrl+C
+    struct pollfd pfd = {ipc_notify_fd(), POLLIN, 0};
+    while (!g_stop) {
+        uint64_t now = ipc_now_ns();
+        if (end && now >= end) break;
+        int timeoutMs = 200;
+        if (end) timeoutMs = (int)std::min<uint64_t>(timeoutMs, (end - now) / 1000000 + 1);
+        if (poll(&pfd, 1, timeoutMs) > 0) ipc_drain_notify();
+        drainJournal();
+    }
+    uint64_t stop = ipc_now_ns();
+    drainJournal();
+    controller.stopAllLines();
+
+    // Con --time-scale los tiempos se informan en tiempo simulado
+    double scale = config.speed_x100 / 100.0;
+    double elapsed = (stop - start) / 1e9 * scale;
+    quint64 completed = 0;
+    for (quint64 c : completedPerLine) completed += c;
+    std::sort(leadTimes.begin(), leadTimes.end());
+
+    std::vector<int> depths;
+    for (int i = 0; i < s->header.station_count; i++) depths.push_back(s->station(0, i).buffer_depth);
+    printf("config: lines=%d stations=%d buffer=%s policy=%s release=%s backend=%s ordered=%d seed=%llu%s\n",
+           s->header.line_count, s->header.station_count, qPrintable(int_list(depths)),
+           dispatch_policy_name(s->header.dispatch_policy), release_policy_name(s->header.release_policy),
+           backend_name(config.backend), config.ordered_output ? 1 : 0, (unsigned long long)s->header.run_seed,
+           qPrintable(route_list(config.routes)));
+    printf("elapsed: %.3f s simulated (%.3f s wall, scale %.2fx)\n", elapsed, (stop - start) / 1e9, scale);
+    printf("dispatched: %llu  completed: %llu  throughput: %.3f /s\n",
+           (unsigned long long)dispatched, (unsigned long long)completed,
+           elapsed > 0 ? completed / elapsed : 0.0);
+    if (completedPerLine.size() > 1) {
+        for (int l = 0; l < completedPerLine.size(); l++) {
+            printf("  line %d: %llu (%.3f /s)\n", l + 1, (unsigned long long)completedPerLine[l],
+                   elapsed > 0 ? completedPerLine[l] / elapsed : 0.0);
+        }
+    }
+    // Throughput contra WIP medio (ley de Little: tiempo en línea ≈ WIP / throughput)
+    double wipMean = 0;
+    for (QueueStat &q : lineWip) {
+        track(q, 0, stop);
+        if (stop > start) wipMean += q.area / (stop - start);
+    }
+    printf("wip: mean %.2f products", wipMean);
+    if (s->header.release_policy == RELEASE_CONWIP) printf(" (limit %d per line)", s->header.wip_limit);
+    double rate = elapsed > 0 ? completed / elapsed : 0.0;
+    printf("  Little lead time: %.1f ms\n", rate > 0 ? wipMean / rate * 1e3 : 0.0);
+    if (!leadTimes.isEmpty()) {
+        printf("lead time ms: min %.1f  p50 %.1f  p95 %.1f  p99 %.1f  max %.1f\n",
+               leadTimes.first() / 1e6 * scale, percentile_ms(leadTimes, 0.50) * scale,
+               percentile_ms(leadTimes, 0.95) * scale, percentile_ms(leadTimes, 0.99) * scale,
+               leadTimes.last() / 1e6 * scale);
+    }
+    // Ocupación media de las colas (en productos) frente a su capacidad
+    for (int l = 0; l < s->header.line_count; l++) {
+        QStringList parts;
+        for (int i = 0; i < s->header.station_count; i++) {
+            const StationBlock &st = s->station(l, i);
+            queueDelta(l * s->header.station_count + i, 0, stop);
+            double mean = stop > start ? queues[l * s->header.station_count + i].area / (stop - start) : 0.0;
+            parts << (st.buffer_depth ? QString("E%1 %2/%3").arg(i + 1).arg(mean, 0, 'f', 2).arg(st.buffer_depth)
+                                      : QString("E%1 direct").arg(i + 1));
+        }
+        printf("queue occupancy L%d: %s\n", l + 1, qPrintable(parts.join("  ")));
+    }
+    if (cursor.lost) printf("journal events lost: %llu\n", (unsigned long long)cursor.lost);
+
+    controller.destroyIPC();
+    return 0;
+}
@@ -5,98 +5,666 @@
 #include <unistd.h>
 #include <cstring>
 #include <cstdio>
+#include <cstdlib>
+#include <sched.h>
+#include <time.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
 
-bool create_ipc() {
-    shm_unlink(SHM_NAME);
+// Mapeo único de la memoria compartida para todo el proceso
+static ShmState* g_state = nullptr;
+static size_t g_size = 0;
 
-    for (int i = 0; i < NUM_STATIONS; i++) {
-        char nameStage[128];
-        snprintf(nameStage, sizeof(nameStage), "/sim_sem_stage_%d", i);
-        sem_unlink(nameStage);
+// eventfd de avisos a la GUI (se conserva entre reinicios de la IPC)
+static int g_notify_fd = -1;
 
-        char nameAck[128];
-        snprintf(nameAck, sizeof(nameAck), "/sim_sem_ack_%d", i);
-        sem_unlink(nameAck);
-    }
+// Archivo con la marca alta de IDs (heredado por el despachador)
+static int g_id_store_fd = -1;
 
-    // Limpiar semáforo de transición
-    sem_unlink(SEM_TRANSITION);
+// Estado en memoria privada del proceso (estaciones como hilos)
+static bool g_private = false;
 
-    int fd = shm_open(SHM_NAME, O_CREAT | O_RDWR, 0666);
-    if (fd == -1) return false;
+// Nombre del objeto en /dev/shm
+static char g_shm_name[64] = SHM_NAME;
 
-    if (ftruncate(fd, sizeof(ShmState)) == -1) {
-        ::close(fd);
-        return false;
+// Mapea size bytes del objeto abierto en fd. Si ya existe un mapeo del mismo
+// tamaño se reemplaza en la misma dirección (MAP_FIXED) para que los punteros
+// obtenidos con ipc_state() desde otros hilos nunca queden apuntando a
+// memoria liberada. Con otro tamaño (otra cantidad de estaciones) se rehace.
+// fd == -1 pide memoria anónima privada del proceso.
+static ShmState* map_state(int fd, size_t size) {
+    if (g_state && g_size != size) {
+        munmap(g_state, g_size);
+        g_state = nullptr;
     }
+    int flags = (fd < 0 ? MAP_PRIVATE | MAP_ANONYMOUS : MAP_SHARED) | (g_state ? MAP_FIXED : 0);
+    void* p = mmap(g_state, size, PROT_READ|PROT_WRITE, flags, fd, 0);
+    if (p == MAP_FAILED) return nullptr;
+    g_state = (ShmState*)p;
+    g_size = size;
+    return g_state;
+}
 
-    ShmState* s = (ShmState*)mmap(NULL, sizeof(ShmState), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
-    ::close(fd);
-    if (s == MAP_FAILED) return false;
+size_t ipc_layout_size(int lineCount, int stationCount) {
+    return sizeof(ShmState) + (size_t)lineCount * sizeof(LineBlock) +
+           (size_t)lineCount * stationCount * sizeof(StationBlock);
+}
 
-    memset(s, 0, sizeof(ShmState));
-    s->running = 1;
-    s->next_product_id = 1;
-    munmap(s, sizeof(ShmState));
+ShmState* ipc_state() {
+    return g_state;
+}
 
-    for (int i = 0; i < NUM_STATIONS; i++) {
-        char nameStage[128];
-        snprintf(nameStage, sizeof(nameStage), "/sim_sem_stage_%d", i);
-        sem_t* semStage = sem_open(nameStage, O_CREAT, 0666, 0);
-        if (semStage == SEM_FAILED) return false;
-        sem_close(semStage);
+uint64_t ipc_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void ipc_set_name(const char* name) {
+    snprintf(g_shm_name, sizeof(g_shm_name), "%s", name);
+}
+
+const char* ipc_name() {
+    return g_shm_name;
+}
+
+void ipc_adopt_fds(int notifyFd, int idStoreFd) {
+    g_notify_fd = notifyFd;
+    g_id_store_fd = idStoreFd;
+}
+
+int ipc_id_store_fd() {
+    return g_id_store_fd;
+}
 
-        char nameAck[128];
-        snprintf(nameAck, sizeof(nameAck), "/sim_sem_ack_%d", i);
-        sem_t* semAck = sem_open(nameAck, O_CREAT, 0666, 0);
-        if (semAck == SEM_FAILED) return false;
-        sem_close(semAck);
+int ipc_notify_fd() {
+    return g_notify_fd;
+}
+
+void ipc_notify() {
+    if (g_notify_fd < 0) return;
+    uint64_t one = 1;
+    ssize_t r = write(g_notify_fd, &one, sizeof(one));
+    (void)r;  // EAGAIN solo si el contador satura: la GUI ya tiene avisos pendientes
+}
+
+void ipc_drain_notify() {
+    if (g_notify_fd < 0) return;
+    uint64_t count;
+    ssize_t r = read(g_notify_fd, &count, sizeof(count));
+    (void)r;
+}
+
+bool create_ipc(int lineCount, int stationCount, int bufferDepth, bool processShared) {
+    if (stationCount < 1) stationCount = 1;
+    if (stationCount > MAX_STATIONS) stationCount = MAX_STATIONS;
+    if (lineCount < 1) lineCount = 1;
+    if (lineCount > MAX_LINES) lineCount = MAX_LINES;
+    if (lineCount * stationCount > MAX_STATIONS) lineCount = MAX_STATIONS / stationCount;
+    size_t size = ipc_layout_size(lineCount, stationCount);
+
+    shm_unlink(g_shm_name);
+
+    // El eventfd debe existir antes del fork() para que los hijos lo hereden.
+    // EFD_CLOEXEC: un exec solo lo conserva si se pasa explícitamente
+    if (g_notify_fd < 0) {
+        g_notify_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (g_notify_fd < 0) return false;
+    } else {
+        ipc_drain_notify();
     }
 
-    // Crear semáforo de transición (inicializado a 1 = disponible)
-    sem_t* semTrans = sem_open(SEM_TRANSITION, O_CREAT, 0666, 1);
-    if (semTrans == SEM_FAILED) return false;
-    sem_close(semTrans);
+    int fd = -1;
+    if (processShared) {
+        fd = shm_open(g_shm_name, O_CREAT | O_RDWR, 0666);
+        if (fd == -1) return false;
+
+        if (ftruncate(fd, size) == -1) {
+            ::close(fd);
+            return false;
+        }
+    }
+
+    ShmState* s = map_state(fd, size);
+    if (fd >= 0) ::close(fd);
+    if (!s) return false;
+    g_private = !processShared;
+
+    memset(static_cast<void*>(s), 0, size);
+    s->header.line_count = lineCount;
+    s->header.station_count = stationCount;
+    s->header.running = 1;
+    s->header.next_product_id = 1;
+    s->header.speed_x100 = SPEED_REALTIME_X100;
+    s->journal.epoch = ipc_now_ns();
+
+    if (bufferDepth < 0) bufferDepth = 0;
+    if (bufferDepth > MAX_BUFFER_DEPTH) bufferDepth = MAX_BUFFER_DEPTH;
+    s->header.buffer_depth = bufferDepth;
+    for (int l = 0; l < lineCount; l++) {
+        ipc_reset_line(s, l);
+    }
 
     return true;
 }
 
+void ipc_reset_line(ShmState* s, int line) {
+    LineBlock& ln = s->line(line);
+    // Mientras se rearman los bloques la línea no es candidata: el
+    // despachador no debe encolar un producto que el memset borraría
+    ln.running.store(0);
+    ln.wip = 0;
+    ln.dispatched = 0;
+    ln.completed = 0;
+    for (int i = 0; i < s->header.station_count; i++) {
+        StationBlock& st = s->station(line, i);
+        // Se conservan la configuración (trabajadores, buffer, modelo de
+        // servicio) y las generaciones de los seqlocks (los observadores no
+        // deben verlas retroceder)
+        bool configured = st.worker_count > 0;
+        int workers = configured ? st.worker_count : DEFAULT_WORKERS;
+        int depth = configured ? st.buffer_depth : s->header.buffer_depth;
+        int cards = configured ? st.kanban_cards : 1;
+        ServiceModel service = configured ? st.service : service_default();
+        int16_t routes[MAX_ROUTES] = {};
+        int route_count = 0;
+        if (configured) {
+            route_count = st.route_count;
+            memcpy(routes, st.routes, sizeof(routes));
+        } else if (i + 1 < s->header.station_count) {
+            // Sin configurar: cadena lineal i → i+1
+            routes[0] = (int16_t)(i + 1);
+            route_count = 1;
+        }
+        uint32_t seq[MAX_WORKERS];
+        for (int w = 0; w < MAX_WORKERS; w++) seq[w] = st.workers[w].lock.seq.load();
+        memset(static_cast<void*>(&st), 0, sizeof(st));
+        for (int w = 0; w < MAX_WORKERS; w++) st.workers[w].lock.seq = (seq[w] + 1) & ~1u;
+        st.worker_count = workers;
+        st.buffer_depth = depth;
+        st.kanban_cards = cards;
+        st.card_sem.count = cards;
+        st.service = service;
+        memcpy(st.routes, routes, sizeof(routes));
+        st.route_count = route_count;
+        // Un crédito por lugar libre. Sin buffer no hay créditos iniciales:
+        // cada trabajador libre ofrece uno (station_run) y el anillo solo
+        // guarda el producto durante la entrega
+        ring_init(&st.input, (uint32_t)(depth > 0 ? depth : workers));
+        st.space_sem.count = depth;
+    }
+    // Recién ahora, con colas y créditos limpios, vuelve a ser candidata
+    ln.running.store(1, std::memory_order_release);
+}
+
 bool open_ipc() {
-    int fd = shm_open(SHM_NAME, O_RDWR, 0666);
+    // Ya mapeado (por create_ipc o heredado del padre en fork)
+    if (g_state) return true;
+
+    int fd = shm_open(g_shm_name, O_RDWR, 0666);
     if (fd == -1) return false;
+
+    // Leer primero la cabecera para conocer cuántas líneas y estaciones hay
+    ShmHeader header;
+    if (pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        header.station_count < 1 || header.line_count < 1 || header.line_count > MAX_LINES ||
+        header.line_count * header.station_count > MAX_STATIONS) {
+        ::close(fd);
+        return false;
+    }
+
+    ShmState* s = map_state(fd, ipc_layout_size(header.line_count, header.station_count));
     ::close(fd);
-    return true;
+    return s != nullptr;
 }
 
 void close_ipc() {
+    if (g_state) {
+        munmap(g_state, g_size);
+        g_state = nullptr;
+        g_size = 0;
+        g_private = false;
+    }
+    if (g_notify_fd >= 0) {
+        ::close(g_notify_fd);
+        g_notify_fd = -1;
+    }
+    if (g_id_store_fd >= 0) {
+        ::close(g_id_store_fd);
+        g_id_store_fd = -1;
+    }
 }
 
+// Elimina los nombres del sistema. El mapeo se conserva hasta close_ipc()
+// (o hasta que create_ipc() lo reemplace) por si algún hilo aún lo lee.
 void destroy_ipc() {
-    shm_unlink(SHM_NAME);
-    for (int i = 0; i < NUM_STATIONS; i++) {
-        char nameStage[128];
-        snprintf(nameStage, sizeof(nameStage), "/sim_sem_stage_%d", i);
-        sem_unlink(nameStage);
+    shm_unlink(g_shm_name);
+}
+
+void ring_init(MpmcRing* r, uint32_t capacity) {
+    r->capacity = capacity;
+    r->head.store(0, std::memory_order_relaxed);
+    r->tail.store(0, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < capacity; i++) {
+        r->cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool ring_push(MpmcRing* r, const ProductInfo& p) {
+    uint64_t pos = r->tail.load(std::memory_order_relaxed);
+    for (;;) {
+        RingCell& c = r->cells[pos % r->capacity];
+        int64_t dif = (int64_t)(c.seq.load(std::memory_order_acquire) - pos);
+        if (dif == 0) {
+            // Celda libre: reservar la posición y publicar el producto
+            if (r->tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                c.product = p;
+                c.seq.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (dif < 0) {
+            return false;  // llena: la celda aún guarda la vuelta anterior
+        } else {
+            pos = r->tail.load(std::memory_order_relaxed);  // otro productor avanzó
+        }
+    }
+}
+
+bool ring_pop(MpmcRing* r, ProductInfo* out, uint64_t* ticket) {
+    uint64_t pos = r->head.load(std::memory_order_relaxed);
+    for (;;) {
+        RingCell& c = r->cells[pos % r->capacity];
+        int64_t dif = (int64_t)(c.seq.load(std::memory_order_acquire) - (pos + 1));
+        if (dif == 0) {
+            if (r->head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                *out = c.product;
+                // Liberar la celda para la siguiente vuelta
+                c.seq.store(pos + r->capacity, std::memory_order_release);
+                if (ticket) *ticket = pos;
+                return true;
+            }
+        } else if (dif < 0) {
+            return false;  // vacía
+        } else {
+            pos = r->head.load(std::memory_order_relaxed);  // otro consumidor avanzó
+        }
+    }
+}
+
+int ring_size(const MpmcRing* r) {
+    uint64_t tail = r->tail.load(std::memory_order_acquire);
+    uint64_t head = r->head.load(std::memory_order_acquire);
+    return tail > head ? (int)(tail - head) : 0;
+}
+
+int ring_peek_all(const MpmcRing* r, ProductInfo* out, int max) {
+    uint64_t head = r->head.load(std::memory_order_acquire);
+    uint64_t tail = r->tail.load(std::memory_order_acquire);
+    int n = 0;
+    for (uint64_t pos = head; pos < tail && n < max; pos++) {
+        const RingCell& c = r->cells[pos % r->capacity];
+        if (c.seq.load(std::memory_order_acquire) != pos + 1) break;  // aún sin publicar
+        out[n++] = c.product;
+    }
+    return n;
+}
+
+
+static inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// seq pasa a impar; la barrera ordena el incremento antes de los datos
+static inline void seq_write_begin(StationLock* l) {
+    l->seq.store(l->seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void station_lock(StationLock* l) {
+    uint32_t expected = 0;
+    if (l->owner.compare_exchange_strong(expected, 1, std::memory_order_acquire)) {
+        l->acquired.fetch_add(1, std::memory_order_relaxed);
+        seq_write_begin(l);
+        return;
+    }
 
-        char nameAck[128];
-        snprintf(nameAck, sizeof(nameAck), "/sim_sem_ack_%d", i);
-        sem_unlink(nameAck);
+    // Camino lento: hay otro dueño (la GUI o la propia estación)
+    uint64_t start = ipc_now_ns();
+    int spins = 0;
+    for (;;) {
+        expected = 0;
+        if (l->owner.load(std::memory_order_relaxed) == 0 &&
+            l->owner.compare_exchange_weak(expected, 1, std::memory_order_acquire)) {
+            break;
+        }
+        if (++spins < 64) cpu_relax();
+        else sched_yield();
     }
-    sem_unlink(SEM_TRANSITION);
+    l->wait_ns.fetch_add(ipc_now_ns() - start, std::memory_order_relaxed);
+    l->contended.fetch_add(1, std::memory_order_relaxed);
+    l->acquired.fetch_add(1, std::memory_order_relaxed);
+    seq_write_begin(l);
 }
 
-sem_t* open_sem_stage(int idx) {
-    char name[128];
-    snprintf(name, sizeof(name), "/sim_sem_stage_%d", idx);
-    return sem_open(name, 0);
+void station_unlock(StationLock* l) {
+    // seq vuelve a par: los lectores que copiaron durante la escritura reintentan
+    l->seq.store(l->seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    l->owner.store(0, std::memory_order_release);
 }
 
-sem_t* open_sem_ack(int idx) {
-    char name[128];
-    snprintf(name, sizeof(name), "/sim_sem_ack_%d", idx);
-    return sem_open(name, 0);
+bool ipc_snapshot(const ShmState* s, ShmSnapshot* out) {
+    int n = s->total_stations();
+    out->line_count = s->header.line_count;
+    out->station_count = s->header.station_count;
+    out->total_stations = n;
+    out->line_running.resize(out->line_count);
+    out->line_wip.resize(out->line_count);
+    out->line_dispatched.resize(out->line_count);
+    out->line_completed.resize(out->line_count);
+    out->station_paused.resize(n);
+    out->station_workers.resize(n);
+    out->worker_done.resize((size_t)n * MAX_WORKERS);
+    out->product_in_worker.resize((size_t)n * MAX_WORKERS);
+    out->worker_rng.resize((size_t)n * MAX_WORKERS);
+    out->queued.resize(n);
+    out->buffer_capacity.resize(n);
+    out->queue.resize((size_t)n * MAX_BUFFER_DEPTH);
+
+    // Un seqlock por trabajador: before[i * MAX_WORKERS + w]. Vive en la
+    // instancia para no reservar memoria en cada lectura
+    out->seq_before.resize((size_t)n * MAX_WORKERS);
+    uint32_t* before = out->seq_before.data();
+    int spins = 0;
+    uint64_t deadline = 0;
+    bool gaveUp = false;
+    for (;;) {
+        bool writing = false;
+        for (int i = 0; i < n; i++) {
+            const StationBlock& st = s->station(i);
+            for (int w = 0; w < st.worker_count; w++) {
+                uint32_t seq = st.workers[w].lock.seq.load(std::memory_order_acquire);
+                before[(size_t)i * MAX_WORKERS + w] = seq;
+                if (seq & 1) writing = true;
+            }
+        }
+        if (writing && !gaveUp) {
+            if (++spins < 64) {
+                cpu_relax();
+                continue;
+            }
+            // Un escritor vivo suelta el candado en microsegundos; si no,
+            // murió con él tomado y se copia lo que haya
+            uint64_t now = ipc_now_ns();
+            if (!deadline) deadline = now + (uint64_t)SNAPSHOT_TIMEOUT_MS * 1000000;
+            if (now < deadline) {
+                sched_yield();
+                continue;
+            }
+            gaveUp = true;
+        }
+
+        out->running = s->header.running;
+        out->next_product_id = s->header.next_product_id.load(std::memory_order_relaxed);
+        out->run_seed = s->header.run_seed;
+        out->buffer_depth = s->header.buffer_depth;
+        out->dispatch_policy = s->header.dispatch_policy.load(std::memory_order_relaxed);
+        out->release_policy = s->header.release_policy;
+        out->wip_limit = s->header.wip_limit;
+        for (int l = 0; l < out->line_count; l++) {
+            out->line_running[l] = s->line(l).running;
+            out->line_wip[l] = s->line(l).wip.load(std::memory_order_relaxed);
+            out->line_dispatched[l] = s->line(l).dispatched.load(std::memory_order_relaxed);
+            out->line_completed[l] = s->line(l).completed.load(std::memory_order_relaxed);
+        }
+        for (int i = 0; i < n; i++) {
+            const StationBlock& st = s->station(i);
+            out->station_paused[i] = st.paused.load(std::memory_order_relaxed);
+            out->station_workers[i] = st.worker_count;
+            out->buffer_capacity[i] = st.buffer_depth;
+            for (int w = 0; w < st.worker_count; w++) {
+                out->worker_done[(size_t)i * MAX_WORKERS + w] = st.workers[w].done;
+                out->product_in_worker[(size_t)i * MAX_WORKERS + w] = st.workers[w].product;
+                out->worker_rng[(size_t)i * MAX_WORKERS + w] = st.rngs[w].rng;
+            }
+            out->queued[i] = ring_peek_all(&st.input, &out->queue[(size_t)i * MAX_BUFFER_DEPTH],
+                                          MAX_BUFFER_DEPTH);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        bool stable = true;
+        for (int i = 0; i < n && stable; i++) {
+            const StationBlock& st = s->station(i);
+            for (int w = 0; w < st.worker_count; w++) {
+                if (st.workers[w].lock.seq.load(std::memory_order_relaxed) !=
+                    before[(size_t)i * MAX_WORKERS + w]) {
+                    stable = false;
+                    break;
+                }
+            }
+        }
+        if (stable || gaveUp) return !gaveUp;
+    }
 }
 
-sem_t* open_sem_transition() {
-    return sem_open(SEM_TRANSITION, 0);
+void ipc_release_line_locks(ShmState* s, int line) {
+    for (int i = 0; i < s->header.station_count; i++) {
+        StationBlock& st = s->station(line, i);
+        for (int w = 0; w < MAX_WORKERS; w++) {
+            StationLock& l = st.workers[w].lock;
+            // Cerrar la escritura a medias: seq vuelve a par hacia adelante
+            uint32_t seq = l.seq.load(std::memory_order_relaxed);
+            if (seq & 1) l.seq.store(seq + 1, std::memory_order_release);
+            l.owner.store(0, std::memory_order_release);
+        }
+    }
+}
+
+static long futex(std::atomic<int32_t>* addr, int op, int32_t val,
+                  const struct timespec* timeout = nullptr) {
+    // FUTEX_PRIVATE_FLAG solo si nadie fuera del proceso usa la palabra:
+    // el kernel evita entonces resolver la página compartida en cada llamada
+    if (g_private) op |= FUTEX_PRIVATE_FLAG;
+    return syscall(SYS_futex, reinterpret_cast<int32_t*>(addr), op, val, timeout, nullptr, 0);
+}
+
+void fsem_post(FutexSem* sem) {
+    sem->count.fetch_add(1);
+    if (sem->waiters.load() > 0) {
+        futex(&sem->count, FUTEX_WAKE, 1);
+    }
+}
+
+bool fsem_try_wait(FutexSem* sem) {
+    int32_t c = sem->count.load();
+    while (c > 0) {
+        if (sem->count.compare_exchange_weak(c, c - 1)) return true;
+    }
+    return false;
+}
+
+int64_t id_store_open(const char* path) {
+    if (g_id_store_fd >= 0) ::close(g_id_store_fd);
+    g_id_store_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (g_id_store_fd < 0) return -1;
+
+    char buf[32] = {0};
+    if (pread(g_id_store_fd, buf, sizeof(buf) - 1, 0) <= 0) return 0;
+    return strtoll(buf, nullptr, 10);
+}
+
+// Registro de ancho fijo: cada escritura reemplaza el anterior completo
+static void id_store_write(int64_t highWater) {
+    if (g_id_store_fd < 0) return;
+    char buf[32];
+    int n = snprintf(buf, sizeof(buf), "%020lld\n", (long long)highWater);
+    if (pwrite(g_id_store_fd, buf, n, 0) == n) fdatasync(g_id_store_fd);
+}
+
+int64_t ipc_next_product_id(ShmState* s, int line) {
+    LineBlock& ln = s->line(line);
+    if (ln.id_next >= ln.id_end) {
+        int64_t base = s->header.next_product_id.fetch_add(ID_BLOCK_SIZE);
+        // Persistir antes de usar el bloque: tras una caída, ningún ID se repite
+        id_store_write(base + ID_BLOCK_SIZE);
+        ln.id_next = base;
+        ln.id_end = base + ID_BLOCK_SIZE;
+    }
+    return ln.id_next++;
+}
+
+void ipc_set_speed(ShmState* s, int speedX100) {
+    if (speedX100 < SPEED_MIN_X100) speedX100 = SPEED_MIN_X100;
+    if (speedX100 > SPEED_MAX_X100) speedX100 = SPEED_MAX_X100;
+    s->header.speed_x100 = speedX100;
+    // El trabajo simulado duerme sobre la palabra de pausa de su estación
+    for (int i = 0; i < s->total_stations(); i++) {
+        futex_wake_word(&s->station(i).paused);
+    }
+}
+
+void ipc_wake_dispatcher(ShmState* s) {
+    s->header.dispatch_wake.fetch_add(1);
+    futex_wake_word(&s->header.dispatch_wake);
+}
+
+const char* release_policy_name(int policy) {
+    switch (policy) {
+    case RELEASE_PUSH:   return "push";
+    case RELEASE_CONWIP: return "CONWIP";
+    case RELEASE_KANBAN: return "kanban";
+    default:             return "?";
+    }
+}
+
+const char* dispatch_policy_name(int policy) {
+    switch (policy) {
+    case DISPATCH_ROUND_ROBIN:    return "round-robin";
+    case DISPATCH_SHORTEST_QUEUE: return "cola más corta";
+    case DISPATCH_LEAST_LOADED:   return "menor carga";
+    default:                      return "?";
+    }
+}
+
+void futex_wait_word(std::atomic<int32_t>* word, int32_t value) {
+    futex(word, FUTEX_WAIT, value);
+}
+
+void futex_wake_word(std::atomic<int32_t>* word) {
+    futex(word, FUTEX_WAKE, INT32_MAX);
+}
+
+void futex_wait_word_for(std::atomic<int32_t>* word, int32_t value, uint64_t timeout_ns) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)(timeout_ns / 1000000000ull);
+    ts.tv_nsec = (long)(timeout_ns % 1000000000ull);
+    futex(word, FUTEX_WAIT, value, &ts);
+}
+
+void fsem_wait(FutexSem* sem) {
+    for (;;) {
+        int32_t c = sem->count.load();
+        while (c > 0) {
+            if (sem->count.compare_exchange_weak(c, c - 1)) return;
+        }
+
+        // Sin señales: dormir mientras count siga en 0. Si un post llega
+        // entre la lectura y la llamada, futex devuelve EAGAIN y se reintenta.
+        sem->waiters.fetch_add(1);
+        futex(&sem->count, FUTEX_WAIT, 0);
+        sem->waiters.fetch_sub(1);
+    }
+}
+
+void journal_append(EventJournal* j, int type, int line, int station, int64_t productId, int worker,
+                    int target) {
+    uint64_t pos = j->write_pos.fetch_add(1, std::memory_order_relaxed);
+    JournalEntry& e = j->entries[pos % JOURNAL_CAPACITY];
+
+    // Invalidar la entrada mientras se escribe (los lectores la descartan)
+    e.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    e.timestamp_ns = ipc_now_ns();
+    e.type = type;
+    e.line = line;
+    e.station = station;
+    e.worker = worker;
+    e.target = target;
+    e.productId = productId;
+
+    e.seq.store(pos + 1, std::memory_order_release);
+
+    if ((pos + 1) % JOURNAL_WAKE_EVERY == 0) {
+        j->fill_wake.fetch_add(1, std::memory_order_release);
+        futex_wake_word(&j->fill_wake);
+    }
+}
+
+void journal_wait(EventJournal* j, int32_t gen, uint64_t timeout_ns) {
+    futex_wait_word_for(&j->fill_wake, gen, timeout_ns);
+}
+
+int journal_read(const EventJournal* j, JournalCursor* cursor, JournalRecord* out, int max) {
+    // IPC recreada (reinicio): empezar de nuevo desde el principio
+    if (cursor->epoch != j->epoch) {
+        cursor->epoch = j->epoch;
+        cursor->next = 0;
+    }
+
+    int n = 0;
+    while (n < max) {
+        uint64_t pos = cursor->next;
+        uint64_t written = j->write_pos.load(std::memory_order_acquire);
+        if (pos >= written) break;  // al día
+
+        // El escritor dio la vuelta al anillo: saltar a la entrada más vieja viva
+        if (written - pos > JOURNAL_CAPACITY) {
+            uint64_t oldest = written - JOURNAL_CAPACITY;
+            cursor->lost += oldest - pos;
+            cursor->next = oldest;
+            continue;
+        }
+
+        const JournalEntry& e = j->entries[pos % JOURNAL_CAPACITY];
+        uint64_t s1 = e.seq.load(std::memory_order_acquire);
+        if (s1 < pos + 1) break;  // reservada pero aún no publicada
+
+        JournalRecord rec;
+        rec.seq = pos;
+        rec.timestamp_ns = e.timestamp_ns;
+        rec.type = e.type;
+        rec.line = e.line;
+        rec.station = e.station;
+        rec.worker = e.worker;
+        rec.target = e.target;
+        rec.productId = e.productId;
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t s2 = e.seq.load(std::memory_order_relaxed);
+        if (s1 != pos + 1 || s2 != pos + 1) {
+            // Sobrescrita mientras se copiaba
+            cursor->lost++;
+            cursor->next = pos + 1;
+            continue;
+        }
+
+        out[n++] = rec;
+        cursor->next = pos + 1;
+    }
+    return n;
+}
+
+const char* journal_event_name(int type) {
+    switch (type) {
+    case EV_ACQUIRED:    return "adquirido";
+    case EV_STARTED:     return "iniciado";
+    case EV_DONE:        return "terminado";
+    case EV_TRANSFERRED: return "transferido";
+    case EV_COMPLETED:   return "completado";
+    case EV_DISPATCHED:  return "despachado";
+    default:             return "?";
+    }
 }
@@ -1,31 +1,429 @@
 #ifndef IPC_COMMON_H
 #define IPC_COMMON_H
 
-#include <semaphore.h>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
 
-#define NUM_STATIONS 5
+#include "service_time.h"
+
+// Número de líneas y de estaciones por línea: se eligen al arrancar y quedan
+// en ShmHeader. MAX_STATIONS limita el total de bloques (líneas × estaciones).
+#define DEFAULT_STATIONS 5
+#define MAX_STATIONS 256
+#define DEFAULT_LINES 1
+#define MAX_LINES 64
 #define SHM_NAME "/sim_shm_if4001_v1"
-#define SEM_TRANSITION "/sim_sem_transition"  // Nuevo
 
+// Tamaño de línea de caché: cada estación escribe en sus propias líneas
+#define CACHE_LINE 64
+
+// Capacidad de las colas entre estaciones (productos en espera / WIP).
+// 0 = sin buffer: el producto pasa directo a un trabajador libre de la
+// estación siguiente y, si no hay ninguno, la estación anterior se bloquea.
+#define MAX_BUFFER_DEPTH 16
+#define DEFAULT_BUFFER_DEPTH 1
+
+// Trabajadores (servidores en paralelo) por estación
+#define MAX_WORKERS 8
+#define DEFAULT_WORKERS 1
+
+// Sucesoras por estación en el grafo de la línea (bifurcaciones)
+#define MAX_ROUTES 4
+
+// Identificadores de 64 bits: no se agotan ni se reutilizan entre sesiones
 struct ProductInfo {
-    int productId;
+    int64_t productId;   // 0 = sin producto
+};
+
+// IDs que reserva una línea de una sola vez del contador global: dentro del
+// bloque los asigna sin tocar memoria compartida por otras líneas
+#define ID_BLOCK_SIZE 64
+
+// Escala de tiempo de la simulación (×100): 0.01× .. 100×
+#define SPEED_MIN_X100 1
+#define SPEED_MAX_X100 10000
+#define SPEED_REALTIME_X100 100
+
+// Espera máxima de ipc_snapshot por un seqlock impar
+#define SNAPSHOT_TIMEOUT_MS 50
+
+// Las colas viven en memoria compartida entre procesos: los atómicos deben
+// ser lock-free (sin mutex interno) para funcionar fuera del proceso creador.
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "std::atomic<uint32_t> debe ser lock-free para usarse entre procesos");
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "std::atomic<uint64_t> debe ser lock-free para usarse entre procesos");
+static_assert(std::atomic<int>::is_always_lock_free,
+              "std::atomic<int> debe ser lock-free para usarse entre procesos");
+
+// Semáforo contador dentro de ShmState. Espera y despierta con futex
+// directamente sobre la palabra compartida: no hay objetos en /dev/shm ni
+// handles que abrir o cerrar. post() solo entra al kernel si hay alguien
+// dormido.
+struct FutexSem {
+    std::atomic<int32_t> count;    // señales disponibles
+    std::atomic<int32_t> waiters;  // procesos dormidos en futex_wait
+};
+static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t),
+              "futex requiere una palabra de 32 bits");
+
+// Candado propio de cada trabajador de una estación: protege su slot, su
+// bandera de terminado y sus movimientos entre colas. Sin contención es un único CAS; solo cuando hay
+// que esperar se mide el tiempo perdido. También es el lado escritor de un
+// seqlock: seq es impar mientras el candado está tomado, así los
+// observadores copian el estado sin tomar el candado (ver ipc_snapshot).
+struct StationLock {
+    std::atomic<uint32_t> owner;      // 0 = libre, 1 = tomado
+    std::atomic<uint32_t> seq;        // generación del seqlock
+    std::atomic<uint64_t> acquired;   // veces que se tomó
+    std::atomic<uint64_t> contended;  // veces que hubo que esperar
+    std::atomic<uint64_t> wait_ns;    // tiempo total esperando (ns)
+};
+
+// Cola circular acotada sin bloqueo de varios productores (trabajadores de
+// las estaciones que alimentan a i, o el despachador) y varios consumidores
+// (trabajadores de la estación i), al estilo Vyukov. head y tail son
+// contadores monotónicos de 64 bits; el índice real es contador % capacity.
+// Cada celda lleva su secuencia: vale pos cuando está libre para escribir
+// la posición pos y pos + 1 cuando tiene el producto publicado. Cada
+// extremo vive en su propia línea de caché.
+struct RingCell {
+    std::atomic<uint64_t> seq;
+    ProductInfo product;
+};
+
+struct MpmcRing {
+    alignas(CACHE_LINE) std::atomic<uint64_t> head;  // siguiente posición a leer (consumidores)
+    alignas(CACHE_LINE) std::atomic<uint64_t> tail;  // siguiente posición a escribir (productores)
+    uint32_t capacity;            // 1..MAX_BUFFER_DEPTH
+    RingCell cells[MAX_BUFFER_DEPTH];
 };
 
+// Bitácora de eventos en memoria compartida: anillo de solo-escritura con
+// varios productores (las estaciones). Cada consumidor (GUI, estadísticas,
+// logs) lleva su propio cursor, así nada se pierde entre dos lecturas.
+#define JOURNAL_CAPACITY 8192  // potencia de 2
+// Cada tanto se despierta a los consumidores que esperan en fill_wake: así
+// vacían la bitácora antes de que el anillo dé la vuelta aunque lean cada
+// segundo y las estaciones escriban más rápido
+#define JOURNAL_WAKE_EVERY (JOURNAL_CAPACITY / 4)
+
+enum JournalEventType : int32_t {
+    EV_ACQUIRED = 1,   // la estación tomó el producto
+    EV_STARTED,        // comenzó el trabajo
+    EV_DONE,           // trabajo terminado, esperando ACK
+    EV_TRANSFERRED,    // encolado en la estación siguiente (target)
+    EV_COMPLETED,      // salió por una estación de salida
+    EV_DISPATCHED      // el despachador lo asignó a una línea (estación 0)
+};
+#define EV_LAST EV_DISPATCHED
+
+// Política con la que el despachador reparte productos nuevos entre líneas
+enum DispatchPolicy : int32_t {
+    DISPATCH_ROUND_ROBIN = 0,   // por turnos, saltando líneas llenas
+    DISPATCH_SHORTEST_QUEUE,    // menos productos esperando a la entrada
+    DISPATCH_LEAST_LOADED       // menor trabajo pendiente (WIP × tiempo de ciclo medido)
+};
+#define DISPATCH_POLICY_COUNT 3
+
+// Cuándo entra un producto nuevo a una línea (la política de despacho
+// elige a cuál). El límite se cuenta por línea.
+enum ReleasePolicy : int32_t {
+    RELEASE_PUSH = 0,   // en cuanto hay lugar en la cola de la estación 0
+    RELEASE_CONWIP,     // además, con menos de wip_limit productos dentro de la línea
+    RELEASE_KANBAN      // cada estación admite hasta kanban_cards productos (cola + trabajadores)
+};
+#define RELEASE_POLICY_COUNT 3
+// Tarjetas kanban por estación: hasta una cola llena más todos sus trabajadores
+#define MAX_KANBAN_CARDS (MAX_BUFFER_DEPTH + MAX_WORKERS)
+
+// seq vale (posición + 1) cuando la entrada está publicada y 0 mientras se
+// escribe; el lector compara seq antes y después de copiar los campos.
+struct JournalEntry {
+    std::atomic<uint64_t> seq;
+    uint64_t timestamp_ns;  // CLOCK_MONOTONIC
+    int64_t productId;
+    int32_t type;
+    int32_t station;
+    int32_t line;
+    int32_t worker;
+    int32_t target;         // EV_TRANSFERRED: estación que lo recibió; -1 en los demás
+};
+
+struct EventJournal {
+    uint64_t epoch;                    // distingue una IPC de la siguiente tras reiniciar
+    alignas(CACHE_LINE) std::atomic<uint64_t> write_pos;   // próxima posición a reservar
+    alignas(CACHE_LINE) std::atomic<int32_t> fill_wake;    // cambia cada JOURNAL_WAKE_EVERY entradas (futex)
+    alignas(CACHE_LINE) JournalEntry entries[JOURNAL_CAPACITY];
+};
+
+// Copia de una entrada ya leída
+struct JournalRecord {
+    uint64_t seq;
+    uint64_t timestamp_ns;
+    int type;
+    int line;
+    int station;           // índice dentro de la línea
+    int worker;
+    int target;            // EV_TRANSFERRED: estación destino dentro de la línea
+    int64_t productId;
+};
+
+// Cursor privado de cada consumidor
+struct JournalCursor {
+    uint64_t epoch = 0;
+    uint64_t next = 0;   // próxima posición a leer
+    uint64_t lost = 0;   // entradas sobrescritas antes de leerlas
+};
+
+// Campos globales, separados de los bloques de las estaciones
+struct alignas(CACHE_LINE) ShmHeader {
+    int line_count;                    // fijos desde create_ipc(); dimensionan todo lo demás
+    int station_count;                 // estaciones por línea
+    int running;                       // 0 = detener todas las líneas
+    int buffer_depth;                  // buffer inicial de cada estación (StationBlock::buffer_depth)
+    std::atomic<int64_t> next_product_id;  // marca alta: primer ID de un bloque sin reservar
+    std::atomic<int32_t> dispatch_policy;  // DispatchPolicy; se puede cambiar en marcha
+    std::atomic<int32_t> dispatch_wake;    // futex: cambia cuando una línea puede admitir más
+    int ordered_output;                    // 1 = cada estación entrega en el orden en que recibió
+    int auto_ack;                          // 1 = las estaciones no esperan el ACK de la GUI
+    std::atomic<int32_t> speed_x100;       // escala de tiempo ×100 (100 = tiempo real); ipc_set_speed
+    uint64_t run_seed;                     // semilla de la corrida: de ella salen todos los generadores
+    int release_policy;                    // ReleasePolicy, fija desde initializeIPC
+    int wip_limit;                         // CONWIP: tope de productos dentro de cada línea
+};
+
+// Estado propio de cada línea de producción (una cadena de estaciones)
+struct alignas(CACHE_LINE) LineBlock {
+    std::atomic<int32_t> running;      // 0 = detener solo esta línea (1 se publica al final de ipc_reset_line)
+    std::atomic<int32_t> wip;          // productos dentro de la línea (despachados - completados)
+    std::atomic<uint64_t> dispatched;  // productos que le asignó el despachador
+    std::atomic<uint64_t> completed;   // productos que salieron por sus estaciones de salida
+    int64_t id_next;                   // bloque de IDs reservado por la línea [id_next, id_end)
+    int64_t id_end;
+};
+
+// Un trabajador de una estación: procesa un producto a la vez. Cada uno
+// ocupa su propia línea de caché; solo él escribe su slot.
+struct alignas(CACHE_LINE) WorkerSlot {
+    StationLock lock;                 // protege done/product y los movimientos entre colas
+    int done;
+    ProductInfo product;              // producto que procesa el trabajador
+    std::atomic<uint64_t> cycle_ewma_ns;  // tiempo de ciclo medido (media móvil), 0 = sin medir
+    FutexSem ack_sem;                 // ACK de la GUI al terminar la animación
+};
+static_assert(sizeof(WorkerSlot) == CACHE_LINE, "WorkerSlot debe ocupar una línea de caché");
+
+// Generador de tiempos de un trabajador. Vive en la memoria compartida para
+// que la GUI lo guarde en el archivo de estado y una sesión restaurada siga
+// la misma secuencia; todo en cero = sin sembrar (station_run lo siembra con
+// su flujo de run_seed). No entra en WorkerSlot: va en su propia línea.
+struct alignas(CACHE_LINE) WorkerRng {
+    ServiceRng rng;
+};
+static_assert(sizeof(WorkerRng) == CACHE_LINE, "WorkerRng debe ocupar una línea de caché");
+
+// Flujo de un trabajador (i es el índice global de la estación): depende
+// solo de la posición, no del pid ni del orden de arranque
+inline uint64_t rng_stream_id(int i, int worker) {
+    return (uint64_t)i * MAX_WORKERS + worker;
+}
+
+// Todo lo que pertenece a una estación, alineado a línea de caché para que
+// las escrituras de una estación no invaliden las líneas de las demás.
+struct alignas(CACHE_LINE) StationBlock {
+    std::atomic<int32_t> paused;      // futex: los trabajadores duermen mientras valga 1
+    int worker_count;                 // 1..MAX_WORKERS, fijo mientras la línea corre
+    int buffer_depth;                 // capacidad de input, 0..MAX_BUFFER_DEPTH (0 = entrega directa)
+    int kanban_cards;                 // RELEASE_KANBAN: productos admitidos a la vez, 1..MAX_KANBAN_CARDS
+    ServiceModel service;             // tiempo de trabajo de la estación (solo lectura)
+    // Tabla de adyacencia: estaciones (de la misma línea) que reciben lo que
+    // sale de esta. Solo hacia adelante (routes[k] > índice propio), así el
+    // grafo no tiene ciclos y la estación 0 es la única entrada. 0 rutas =
+    // estación de salida: ahí se completa el producto.
+    int16_t routes[MAX_ROUTES];
+    int route_count;
+
+    // Señales que escriben los vecinos y la GUI, en otra línea
+    alignas(CACHE_LINE) FutexSem stage_sem;  // despierta a un trabajador (hay trabajo)
+    FutexSem space_sem;               // créditos: lugares libres en input (sin buffer: trabajadores libres)
+    FutexSem card_sem;                // tarjetas kanban libres; la toma quien entrega y la devuelve el trabajador al salir
+    std::atomic<int32_t> cards_owed;  // tarjetas que no se devuelven (productos restaurados por encima del límite)
+    std::atomic<int32_t> out_turn;    // futex: turno de salida en modo ordenado
+    std::atomic<uint32_t> route_turn; // reparto por turnos entre las sucesoras de una bifurcación
+
+    MpmcRing input;                   // cola de entrada (la de la estación 0 la llena el despachador)
+    WorkerSlot workers[MAX_WORKERS];
+    WorkerRng rngs[MAX_WORKERS];      // escribe solo el trabajador dueño
+};
+static_assert(sizeof(StationBlock) % CACHE_LINE == 0, "StationBlock debe ocupar líneas completas");
+
+// Parte fija de la memoria compartida. A continuación van line_count bloques
+// de línea y luego line_count × station_count bloques de estación, línea por
+// línea (tamaño variable, ver ipc_layout_size). Cada línea solo escribe en
+// sus propios bloques: las líneas avanzan en paralelo sin compartir candados.
 struct ShmState {
-    int running;
-    int station_done[NUM_STATIONS];
-    int station_paused[NUM_STATIONS];
-    ProductInfo product_in_station[NUM_STATIONS];
-    int next_product_id;
+    ShmHeader header;
+    EventJournal journal;
+
+    LineBlock& line(int l) { return reinterpret_cast<LineBlock*>(this + 1)[l]; }
+    const LineBlock& line(int l) const { return reinterpret_cast<const LineBlock*>(this + 1)[l]; }
+
+    // i es el índice global: línea * station_count + estación
+    StationBlock& station(int i) {
+        return reinterpret_cast<StationBlock*>(&line(header.line_count))[i];
+    }
+    const StationBlock& station(int i) const {
+        return reinterpret_cast<const StationBlock*>(&line(header.line_count))[i];
+    }
+    StationBlock& station(int l, int i) { return station(l * header.station_count + i); }
+    const StationBlock& station(int l, int i) const { return station(l * header.station_count + i); }
+
+    int total_stations() const { return header.line_count * header.station_count; }
+};
+static_assert(sizeof(ShmState) % CACHE_LINE == 0, "los bloques de estación deben quedar alineados");
+
+// Bytes que ocupa la memoria compartida con esa cantidad de líneas y estaciones
+size_t ipc_layout_size(int lineCount, int stationCount);
+
+// Copia coherente de ShmState para observadores (GUI, hilos, guardado).
+// Ningún producto aparece en dos lugares ni desaparece en una transferencia.
+// Los vectores de estación usan el índice global (línea * station_count +
+// estación); conviene reutilizar la misma instancia entre lecturas para no
+// volver a reservar memoria.
+struct ShmSnapshot {
+    int line_count = 0;
+    int station_count = 0;                   // por línea
+    int total_stations = 0;
+    int running = 0;
+    std::vector<int> line_running;
+    std::vector<int> line_wip;
+    std::vector<uint64_t> line_dispatched;
+    std::vector<uint64_t> line_completed;
+    int dispatch_policy = 0;
+    int release_policy = 0;
+    int wip_limit = 0;
+    int64_t next_product_id = 0;           // marca alta de IDs reservados
+    uint64_t run_seed = 0;
+    int buffer_depth = 0;
+    std::vector<int> station_paused;
+    std::vector<int> station_workers;        // trabajadores de la estación i
+    std::vector<int> worker_done;            // worker_done[i * MAX_WORKERS + w]
+    std::vector<ProductInfo> product_in_worker;  // product_in_worker[i * MAX_WORKERS + w]
+    std::vector<ServiceRng> worker_rng;      // worker_rng[i * MAX_WORKERS + w]
+    std::vector<int> queued;                 // productos en la cola de entrada de i
+    std::vector<int> buffer_capacity;        // capacidad de esa cola (0 = sin buffer)
+    std::vector<ProductInfo> queue;          // queue[i * MAX_BUFFER_DEPTH + k]
+    std::vector<uint32_t> seq_before;        // uso interno de ipc_snapshot: seqlocks leídos al empezar
+
+    // Trabajadores de la estación i con un producto
+    int busy_workers(int i) const {
+        int n = 0;
+        for (int w = 0; w < station_workers[i]; w++) {
+            if (product_in_worker[(size_t)i * MAX_WORKERS + w].productId > 0) n++;
+        }
+        return n;
+    }
 };
 
-bool create_ipc();
+// El mapeo de ShmState se crea una sola vez por proceso (create_ipc/open_ipc)
+// y se comparte entre GUI, controlador e hilos. Los hijos lo heredan en fork().
+// Con processShared = false el estado vive en memoria anónima del proceso
+// (sin objeto en /dev/shm) y los futex son privados: solo para estaciones
+// que corren como hilos.
+bool create_ipc(int lineCount = DEFAULT_LINES, int stationCount = DEFAULT_STATIONS,
+                int bufferDepth = DEFAULT_BUFFER_DEPTH, bool processShared = true);
+// Deja las estaciones de una línea vacías (colas, slots, semáforos) y la
+// marca en marcha. Solo con los procesos de esa línea detenidos. Para
+// cambiar trabajadores o buffer de una estación: escribirlos y resetear.
+void ipc_reset_line(ShmState* s, int line);
 bool open_ipc();
 void close_ipc();
 void destroy_ipc();
 
-sem_t* open_sem_stage(int idx);
-sem_t* open_sem_ack(int idx);
-sem_t* open_sem_transition();  // Nuevo
+// Mapeo persistente del proceso (nullptr si la IPC no está abierta)
+ShmState* ipc_state();
+
+// Nombre del objeto de memoria compartida (SHM_NAME por omisión). El
+// ejecutable `station` lo recibe por línea de comandos antes de open_ipc().
+void ipc_set_name(const char* name);
+const char* ipc_name();
+
+// Descriptores que un proceso lanzado con posix_spawn recibe ya abiertos
+// (eventfd de avisos y archivo de IDs); -1 si no corresponde
+void ipc_adopt_fds(int notifyFd, int idStoreFd);
+int ipc_id_store_fd();
+
+// Aviso de cambios a la GUI: eventfd creado por create_ipc() antes de fork().
+// Las estaciones llaman ipc_notify() al cambiar de estado; la GUI vigila
+// ipc_notify_fd() y vacía el contador con ipc_drain_notify().
+int ipc_notify_fd();
+void ipc_notify();
+void ipc_drain_notify();
+
+// Operaciones de la cola MPMC: devuelven false si está llena / vacía.
+// ring_pop entrega en ticket la posición leída (orden de llegada).
+void ring_init(MpmcRing* r, uint32_t capacity);
+bool ring_push(MpmcRing* r, const ProductInfo& p);
+bool ring_pop(MpmcRing* r, ProductInfo* out, uint64_t* ticket = nullptr);
+int ring_size(const MpmcRing* r);
+// Copia (sin consumir) los productos en espera; devuelve cuántos copió
+int ring_peek_all(const MpmcRing* r, ProductInfo* out, int max);
+
+// Candado por estación (lado escritor del seqlock)
+void station_lock(StationLock* l);
+void station_unlock(StationLock* l);
+
+// Lectura sin candados: reintenta hasta obtener una vista coherente. Si
+// un seqlock sigue impar más de SNAPSHOT_TIMEOUT_MS (un trabajador murió
+// con el candado tomado) copia igual y devuelve false: la vista puede
+// estar mezclada.
+bool ipc_snapshot(const ShmState* s, ShmSnapshot* out);
+// Libera los candados que dejaron tomados los trabajadores de una línea
+// muertos con SIGKILL. Solo con todos los procesos de esa línea detenidos.
+void ipc_release_line_locks(ShmState* s, int line);
+
+// Semáforo futex en memoria compartida
+void fsem_post(FutexSem* sem);
+void fsem_wait(FutexSem* sem);
+bool fsem_try_wait(FutexSem* sem);
+
+// Bitácora de eventos
+uint64_t ipc_now_ns();
+void journal_append(EventJournal* j, int type, int line, int station, int64_t productId,
+                    int worker = 0, int target = -1);
+// Lee hasta max entradas nuevas desde el cursor; devuelve cuántas leyó
+int journal_read(const EventJournal* j, JournalCursor* cursor, JournalRecord* out, int max);
+// Duerme hasta timeout_ns o hasta que se escriban JOURNAL_WAKE_EVERY
+// entradas desde que se leyó fill_wake (gen)
+void journal_wait(EventJournal* j, int32_t gen, uint64_t timeout_ns);
+const char* journal_event_name(int type);
+
+// Próximo ID para un producto de la línea. Sin contención: solo al agotar
+// el bloque se hace un fetch_add de ID_BLOCK_SIZE sobre la marca alta, que
+// se guarda en disco (id_store_open) antes de usar el bloque. Un solo
+// productor por línea (el despachador).
+int64_t ipc_next_product_id(ShmState* s, int line);
+
+// Archivo con la marca alta de IDs. Se abre en el padre antes de fork();
+// devuelve la marca guardada (0 si el archivo es nuevo) o -1 si falla.
+int64_t id_store_open(const char* path);
+
+// Cambia la escala de tiempo en marcha (acotada a SPEED_MIN..MAX) y
+// despierta a los trabajadores dormidos para que reescalen lo que les falta
+void ipc_set_speed(ShmState* s, int speedX100);
+
+// Avisa al despachador que una línea liberó lugar o cambió de estado
+void ipc_wake_dispatcher(ShmState* s);
+const char* dispatch_policy_name(int policy);
+const char* release_policy_name(int policy);
+
+// Espera/despertar directos sobre una palabra compartida
+void futex_wait_word(std::atomic<int32_t>* word, int32_t value);  // duerme si *word == value
+void futex_wake_word(std::atomic<int32_t>* word);                 // despierta a todos
+// Como futex_wait_word, pero vuelve a más tardar tras timeout_ns
+void futex_wait_word_for(std::atomic<int32_t>* word, int32_t value, uint64_t timeout_ns);
 
 #endif // IPC_COMMON_H
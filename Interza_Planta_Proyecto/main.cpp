@@ -1,10 +1,15 @@
 #include "mainwindow.h"
+#include "sim_config.h"
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
-    MainWindow w;
+
+    SimConfig config;
+    parse_sim_args(argc, argv, config);
+
+    MainWindow w(config);
     w.show();
     w.showMaximized();  //abrir maximizada
     return a.exec();
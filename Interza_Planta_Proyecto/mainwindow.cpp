@@ -8,9 +8,6 @@
 #include <QMetaObject>
 
 #include <unistd.h>
-#include <fcntl.h>
-#include <sys/mman.h>
-#include <sys/stat.h>
 #include <signal.h>
 #include <sys/types.h>
 
@@ -25,8 +22,9 @@
 #include "ipc_common.h"
 #include <QHBoxLayout>
 #include <QMessageBox>
+#include <QScrollArea>
 
-MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), processedCount(0) {
+MainWindow::MainWindow(const SimConfig &config, QWidget *parent) : QMainWindow(parent), processedCount(0) {
     setMinimumSize(1000, 700);
     resize(1200, 800);
 
@@ -69,7 +67,7 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), processedCount(0)
     statsLayout->setContentsMargins(8, 5, 8, 5);
     statsPanel->setStyleSheet("background:#ECF0F1; border-radius:6px;");
 
-    statsLabel = new QLabel("📊 Estaciones Activas: 0/5 | Recursos: 0 | Sistema: Iniciando...", this);
+    statsLabel = new QLabel(QString("📊 Estaciones Activas: 0/%1 | Recursos: 0 | Sistema: Iniciando...").arg(config.lines * config.stations), this);
     statsLabel->setStyleSheet("font-size:12px; color:#2C3E50; font-weight:bold;");
     statsLayout->addWidget(statsLabel);
 
@@ -103,7 +101,21 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), processedCount(0)
         "🚚 Carga a Transporte"
     };
 
-    for (int i=0; i<NUM_STATIONS; i++){
+    // Las primeras estaciones conservan su nombre e imagen; las demás
+    // (--stations mayor que 5) se numeran y reutilizan las imágenes
+    lineCount = config.lines;
+    stationsPerLine = config.stations;
+    observerMode = config.auto_ack;
+    lastDoneMs.fill(0, lineCount * stationsPerLine);
+    beltClock.start();
+    auto stationName = [&](int i) {
+        return i < stationNames.size() ? stationNames[i] : QString("🏭 Estación %1").arg(i + 1);
+    };
+
+    // Una página por estación de cada línea: página = línea * stationsPerLine + estación
+    for (int n=0; n<lineCount*stationsPerLine; n++){
+        int l = n / stationsPerLine;
+        int i = n % stationsPerLine;
         QWidget *page = new QWidget(this);
         page->setStyleSheet("background: qlineargradient(x1:0, y1:0, x2:0, y2:1, "
                             "stop:0 #FDFEFE, stop:1 #ECF0F1);");
@@ -111,7 +123,16 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), processedCount(0)
         v->setSpacing(5);
         v->setContentsMargins(5, 5, 5, 5);
 
-        QLabel *lab = new QLabel(QString("ESTACIÓN %1: %2").arg(i+1).arg(stationNames[i]));
+        QString title = QString("ESTACIÓN %1: %2").arg(i+1).arg(stationName(i));
+        if (config.workersAt(i) > 1) title += QString(" (×%1 trabajadores)").arg(config.workersAt(i));
+        if (!config.routes.empty()) {
+            // Grafo propio (--route): a qué estaciones envía esta
+            QStringList next;
+            for (int to : config.routesAt(i)) next << QString::number(to + 1);
+            title += next.isEmpty() ? QString(" → SALIDA") : QString(" → %1").arg(next.join(" · "));
+        }
+        if (lineCount > 1) title = QString("LÍNEA %1 · %2").arg(l+1).arg(title);
+        QLabel *lab = new QLabel(title);
         lab->setAlignment(Qt::AlignCenter);
         lab->setStyleSheet("font-size:16px; font-weight:bold; "
                            "background:qlineargradient(x1:0, y1:0, x2:1, y2:0, "
@@ -119,8 +140,14 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), processedCount(0)
                            "padding:10px; border-radius:6px; color:white;");
         v->addWidget(lab);
 
+        QLabel *buffer = new QLabel();
+        buffer->setAlignment(Qt::AlignCenter);
+        buffer->setStyleSheet("font-size:12px; color:#2C3E50; font-weight:bold;");
+        bufferLabels.append(buffer);
+        v->addWidget(buffer);
+
         TransportBeltWidget *belt = new TransportBeltWidget(this);
-        QString img = (i < beltImages.size()) ? beltImages[i] : QString();
+        QString img = beltImages[i % beltImages.size()];
         belt->setupWithImage(img);
         belts.append(belt);
         v->addWidget(belt);
@@ -141,8 +168,19 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), processedCount(0)
     navLayout->setSpacing(5);
     navLayout->setContentsMargins(0, 0, 0, 0);
 
-    for (int i=0; i<NUM_STATIONS; i++){
-        QPushButton *b = new QPushButton(stationNames[i]);
+    // Con varias líneas, los botones de estación muestran la línea elegida
+    if (lineCount > 1) {
+        lineSelector = new QComboBox();
+        for (int l=0; l<lineCount; l++) lineSelector->addItem(QString("🏭 Línea %1").arg(l+1));
+        lineSelector->setStyleSheet("QComboBox { background:#2C3E50; color:white; padding:6px; "
+                                    "border-radius:5px; font-weight:bold; font-size:11px; }");
+        connect(lineSelector, QOverload<int>::of(&QComboBox::currentIndexChanged),
+                this, &MainWindow::onLineSelected);
+        navLayout->addWidget(lineSelector);
+    }
+
+    for (int i=0; i<stationsPerLine; i++){
+        QPushButton *b = new QPushButton(stationName(i));
         b->setProperty("lineIndex", i);
         b->setStyleSheet("QPushButton { background:#16A085; color:white; padding:8px; "
                          "border-radius:5px; font-weight:bold; font-size:11px; }"
@@ -152,7 +190,15 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), processedCount(0)
         navLayout->addWidget(b);
         lineButtons.append(b);
     }
-    bottomLayout->addWidget(navRow);
+
+    // Con muchas estaciones los botones se desplazan en lugar de comprimirse
+    QScrollArea *navScroll = new QScrollArea();
+    navScroll->setWidget(navRow);
+    navScroll->setWidgetResizable(true);
+    navScroll->setFrameShape(QFrame::NoFrame);
+    navScroll->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    navScroll->setFixedHeight(navRow->sizeHint().height() + 16);
+    bottomLayout->addWidget(navScroll);
 
     QWidget *controlRow = new QWidget();
     QHBoxLayout *controlLayout = new QHBoxLayout(controlRow);
@@ -173,6 +219,40 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), processedCount(0)
     connect(resumeButton, &QPushButton::clicked, this, &MainWindow::onResumeClicked);
     controlLayout->addWidget(resumeButton);
 
+    if (lineCount > 1) {
+        lineToggleButton = new QPushButton("⏹️ Detener línea 1");
+        lineToggleButton->setStyleSheet("QPushButton { background:#8E44AD; color:white; padding:8px; "
+                                        "border-radius:5px; font-weight:bold; }"
+                                        "QPushButton:hover { background:#A569BD; }");
+        connect(lineToggleButton, &QPushButton::clicked, this, &MainWindow::onLineToggleClicked);
+        controlLayout->addWidget(lineToggleButton);
+
+        policySelector = new QComboBox();
+        for (int p = 0; p < DISPATCH_POLICY_COUNT; p++) {
+            policySelector->addItem(QString("🔀 %1").arg(dispatch_policy_name(p)));
+        }
+        policySelector->setCurrentIndex(config.dispatch_policy);
+        policySelector->setStyleSheet("QComboBox { background:#2C3E50; color:white; padding:6px; "
+                                      "border-radius:5px; font-weight:bold; }");
+        controlLayout->addWidget(policySelector);
+    }
+
+    // Escala de tiempo: se aplica en marcha a estaciones y animaciones
+    speedSelector = new QComboBox();
+    const double speeds[] = {0.01, 0.1, 0.25, 0.5, 1, 2, 5, 10, 100};
+    for (double f : speeds) {
+        speedSelector->addItem(QString("⏱️ %1×").arg(f), f);
+        if (qRound(f * 100) == config.speed_x100) speedSelector->setCurrentIndex(speedSelector->count() - 1);
+    }
+    if (speedSelector->findData(config.speed_x100 / 100.0) < 0) {
+        // Valor de --time-scale fuera de los predefinidos
+        speedSelector->addItem(QString("⏱️ %1×").arg(config.speed_x100 / 100.0), config.speed_x100 / 100.0);
+        speedSelector->setCurrentIndex(speedSelector->count() - 1);
+    }
+    speedSelector->setStyleSheet("QComboBox { background:#2C3E50; color:white; padding:6px; "
+                                 "border-radius:5px; font-weight:bold; }");
+    controlLayout->addWidget(speedSelector);
+
     deleteLotButton = new QPushButton("🔄 Reiniciar");
     deleteLotButton->setStyleSheet("QPushButton { background:#E74C3C; color:white; padding:8px; "
                                    "border-radius:5px; font-weight:bold; }"
@@ -208,7 +288,17 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), processedCount(0)
                            "stop:0 #ECF0F1, stop:1 #D5DBDB);");
 
     controller = new ProductionController(this);
+    controller->setConfig(config);
+    controller->setIdStorePath(idStorePath());
+    controller->setStationExecutable(QCoreApplication::applicationDirPath() + "/station");
+    if (policySelector) {
+        connect(policySelector, QOverload<int>::of(&QComboBox::currentIndexChanged),
+                controller, &ProductionController::setDispatchPolicy);
+    }
     connect(controller, &ProductionController::logMessage, this, &MainWindow::onLogMessage);
+    connect(speedSelector, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &MainWindow::onSpeedSelected);
+    for (TransportBeltWidget *belt : belts) belt->setTimeScale(config.speed_x100 / 100.0);
 
     threadManager = new ThreadManager(this);
     connect(threadManager, &ThreadManager::log, this, &MainWindow::onLogMessage);
@@ -226,8 +316,16 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), processedCount(0)
         onLogMessage("⚠️ ADVERTENCIA: No se pudieron arrancar todos los procesos");
     }
 
-    connect(&pollTimer, &QTimer::timeout, this, &MainWindow::pollSharedMemory);
-    pollTimer.start(150);
+    // La GUI solo despierta cuando una estación cambia de estado
+    refreshTimer = new QTimer(this);
+    refreshTimer->setSingleShot(true);
+    connect(refreshTimer, &QTimer::timeout, this, &MainWindow::pollSharedMemory);
+    refreshClock.start();
+    if (observerMode) onLogMessage("👁️ Modo observador: la producción no espera a la interfaz");
+
+    stationNotifier = new QSocketNotifier(ipc_notify_fd(), QSocketNotifier::Read, this);
+    connect(stationNotifier, &QSocketNotifier::activated, this, &MainWindow::onStationEvent);
+    pollSharedMemory();
 }
 
 MainWindow::~MainWindow() {
@@ -236,96 +334,202 @@ MainWindow::~MainWindow() {
 
 void MainWindow::onLineButtonClicked() {
     QPushButton *b = qobject_cast<QPushButton*>(sender());
-    int idx = b->property("lineIndex").toInt();
-    viewStack->setCurrentIndex(idx);
+    currentStationView = b->property("lineIndex").toInt();
+    viewStack->setCurrentIndex(currentLine * stationsPerLine + currentStationView);
+}
+
+void MainWindow::onLineSelected(int line) {
+    if (line < 0 || line >= lineCount) return;
+    currentLine = line;
+    viewStack->setCurrentIndex(currentLine * stationsPerLine + currentStationView);
+    updateLineToggleButton();
+}
+
+void MainWindow::onLineToggleClicked() {
+    if (controller->isLineRunning(currentLine)) {
+        controller->stopLine(currentLine);
+        showNotification(QString("Línea %1 detenida").arg(currentLine + 1), "warning");
+    } else if (controller->startLine(currentLine)) {
+        // La línea vuelve a empezar vacía: limpiar sus bandas
+        for (int i = 0; i < stationsPerLine; i++) {
+            belts[currentLine * stationsPerLine + i]->resetPosition();
+        }
+        showNotification(QString("Línea %1 arrancada").arg(currentLine + 1), "success");
+    }
+    updateLineToggleButton();
+}
+
+void MainWindow::updateLineToggleButton() {
+    if (!lineToggleButton) return;
+    lineToggleButton->setText(controller->isLineRunning(currentLine)
+                                  ? QString("⏹️ Detener línea %1").arg(currentLine + 1)
+                                  : QString("▶️ Arrancar línea %1").arg(currentLine + 1));
 }
 
 void MainWindow::onShutdownClicked() {
     this->close();
 }
 
-void MainWindow::pollSharedMemory() {
-    static int cleanupCounter = 0;
-    cleanupCounter++;
+void MainWindow::onSpeedSelected(int index) {
+    double scale = speedSelector->itemData(index).toDouble();
+    controller->setTimeScale(scale);
+    for (TransportBeltWidget *belt : belts) belt->setTimeScale(scale);
+}
 
-    int fd = shm_open(SHM_NAME, O_RDWR, 0666);
-    if (fd == -1) {
+void MainWindow::onStationEvent() {
+    // Vaciar el contador del eventfd: un solo repaso cubre todos los avisos acumulados
+    ipc_drain_notify();
+
+    // En modo observador la GUI repasa como mucho ~30 veces por segundo: los
+    // avisos que llegan antes se juntan en un repaso diferido
+    const int minRefreshMs = 33;
+    if (observerMode && refreshClock.elapsed() < minRefreshMs) {
+        if (!refreshTimer->isActive()) refreshTimer->start(minRefreshMs - (int)refreshClock.elapsed());
         return;
     }
-    ShmState* s = (ShmState*)mmap(NULL, sizeof(ShmState), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
-    if (s==MAP_FAILED) { ::close(fd); return; }
+    pollSharedMemory();
+}
+
+void MainWindow::pollSharedMemory() {
+    ShmState* s = ipc_state();
+    if (!s) return;
+    refreshClock.restart();
+
+    // Consumir la bitácora desde nuestro cursor: ninguna transición se pierde
+    JournalRecord events[256];
+    int n;
+    while ((n = journal_read(&s->journal, &journalCursor, events, 256)) > 0) {
+        for (int k = 0; k < n; k++) {
+            handleJournalEvent(events[k]);
+        }
+    }
+    if (journalCursor.lost > reportedLostEvents) {
+        onLogMessage(QString("⚠️ Bitácora: %1 eventos sobrescritos antes de leerlos")
+                         .arg(journalCursor.lost - reportedLostEvents));
+        reportedLostEvents = journalCursor.lost;
+    }
+
+    // Vista coherente del estado (sin tomar los candados de las estaciones)
+    ShmSnapshot &snap = pollSnap;
+    ipc_snapshot(s, &snap);
 
-    // Contar estaciones activas
+    // Contar estaciones activas (con al menos un trabajador ocupado)
     int activeStations = 0;
-    for (int i = 0; i < NUM_STATIONS; i++) {
-        if (s->product_in_station[i].productId > 0) {
+    for (int i = 0; i < snap.total_stations; i++) {
+        if (snap.busy_workers(i) > 0) {
             activeStations++;
         }
     }
-    int resourcesUsed = activeStations + (s->running ? 1 : 0);
-    int totalProductsCreated = s->next_product_id - 1;
-
-    if (processedCount > totalProductsCreated) {
-        processedCount = totalProductsCreated;
-        counterLabel->setText(QString("📦 Productos Completados: %1").arg(processedCount));
+    int runningLines = 0;
+    for (int l = 0; l < snap.line_count; l++) {
+        if (snap.line_running[l]) runningLines++;
     }
+    int resourcesUsed = activeStations + (snap.running ? 1 : 0);
+    // Los IDs se reservan por bloques: la marca alta no cuenta productos.
+    // En proceso = productos dentro de las líneas.
+    int inProcess = 0;
+    for (int l = 0; l < snap.line_count; l++) {
+        inProcess += snap.line_wip[l];
+    }
+    int totalProductsCreated = processedCount + inProcess;
+
+    QString stats = QString("📊 Activas: %1/%6 | Recursos: %2 | ✅ Completados: %3 | 📦 Totales: %4 | ⏳ En Proceso: %5")
+                        .arg(activeStations)
+                        .arg(resourcesUsed)
+                        .arg(processedCount)
+                        .arg(totalProductsCreated)
+                        .arg(inProcess)
+                        .arg(snap.total_stations);
+    if (snap.line_count > 1) {
+        // Cola de entrada de cada línea: muestra si el despachador las mantiene ocupadas
+        QStringList queues;
+        for (int l = 0; l < snap.line_count; l++) {
+            queues << QString::number(snap.queued[l * snap.station_count]);
+        }
+        stats += QString(" | 🏭 Líneas: %1/%2 | 📥 Colas: %3")
+                     .arg(runningLines).arg(snap.line_count).arg(queues.join("·"));
+    }
+    // Colas entre estaciones de la línea visible: ocupación / capacidad
+    QStringList buffers;
+    for (int i = 0; i < snap.station_count; i++) {
+        int g = currentLine * snap.station_count + i;
+        int cap = snap.buffer_capacity[g];
+        QString text = cap ? QString("📥 Buffer de entrada: %1/%2").arg(snap.queued[g]).arg(cap)
+                           : QString("📥 Sin buffer: entrega directa");
+        if (bufferLabels[g]->text() != text) bufferLabels[g]->setText(text);
+        buffers << (cap ? QString("%1/%2").arg(snap.queued[g]).arg(cap) : QString("–"));
+    }
+    stats += QString(" | 📥 Buffers: %1").arg(buffers.join("·"));
+    statsLabel->setText(stats);
+}
 
-    int inProcess = totalProductsCreated - processedCount;
-    if (inProcess < 0) inProcess = 0;
-
-    statsLabel->setText(QString("📊 Activas: %1/5 | Recursos: %2 | ✅ Completados: %3 | 📦 Totales: %4 | ⏳ En Proceso: %5")
-                            .arg(activeStations)
-                            .arg(resourcesUsed)
-                            .arg(processedCount)
-                            .arg(totalProductsCreated)
-                            .arg(inProcess));
-
-    for (int i=0; i<NUM_STATIONS; i++){
-        if (s->station_done[i] == 1) {
-            // VERIFICAR que realmente hay un producto válido antes de animar
-            int productId = s->product_in_station[i].productId;
-            if (productId <= 0) {
-                // Producto fantasma - limpiar flag y continuar
-                s->station_done[i] = 0;
-                continue;
+void MainWindow::handleJournalEvent(const JournalRecord &ev) {
+    if (ev.line < 0 || ev.line >= lineCount || ev.station < 0 || ev.station >= stationsPerLine) return;
+    int stationIndex = ev.line * stationsPerLine + ev.station;  // índice global
+    int station = ev.station;
+    int line = ev.line;
+    int worker = ev.worker;
+    qint64 productId = ev.productId;
+    if (worker < 0 || worker >= MAX_WORKERS) return;
+
+    switch (ev.type) {
+    case EV_DONE:
+        if (observerMode) {
+            // Nadie espera el ACK: la banda solo refleja el último producto.
+            // Si los productos llegan más rápido que la animación, esta se
+            // acorta al intervalo entre ellos; sin nada visible, no se anima.
+            qint64 now = beltClock.elapsed();
+            qint64 gap = now - lastDoneMs[stationIndex];
+            lastDoneMs[stationIndex] = now;
+            if (!isMinimized() && belts[stationIndex]->isVisible()) {
+                belts[stationIndex]->showLatest((int)qBound<qint64>(300, gap, 5000));
             }
+            break;
+        }
 
-            s->station_done[i] = 2;
-            int stationIndex = i;
-
-            belts[stationIndex]->startAnimation(1, [this, stationIndex, productId]() {
-                sem_t* ack = open_sem_ack(stationIndex);
-                if (ack) sem_post(ack);
+        // Con varios trabajadores la banda puede estar animando otro producto
+        // de la misma estación: ese ACK se envía sin esperar a la animación
+        if (belts[stationIndex]->isBusy()) {
+            ShmState* s2 = ipc_state();
+            if (s2) fsem_post(&s2->station(stationIndex).workers[worker].ack_sem);
+            break;
+        }
 
-                if (stationIndex == NUM_STATIONS - 1) {
-                    processedCount++;
-                    counterLabel->setText(QString("📦 Productos Completados: %1").arg(processedCount));
-                    onLogMessage(QString("✅ Producto #%1 finalizado. Total: %2").arg(productId).arg(processedCount));
+        // El trabajador espera el ACK: se envía al terminar la animación
+        belts[stationIndex]->startAnimation(1, [this, stationIndex, station, line, worker, productId]() {
+            ShmState* s2 = ipc_state();
+            if (s2) fsem_post(&s2->station(stationIndex).workers[worker].ack_sem);
 
-                    if (processedCount % 5 == 0) {
-                        showNotification(QString("¡%1 productos completados!").arg(processedCount), "success");
-                    }
-                } else {
-                    onLogMessage(QString("➤ Estación %1: producto #%2 procesado, enviando ACK").arg(stationIndex+1).arg(productId));
-                }
+            if (s2 && s2->station(stationIndex).route_count > 0) {
+                onLogMessage(QString("➤ %1Estación %2: producto #%3 procesado, enviando ACK")
+                                 .arg(linePrefix(line)).arg(station+1).arg(productId));
+            }
+        });
+        onLogMessage(QString("🔄 %1Estación %2: GUI inició animación para producto #%3")
+                         .arg(linePrefix(line)).arg(station+1).arg(productId));
+        break;
 
-                int fd2 = shm_open(SHM_NAME, O_RDWR, 0666);
-                if (fd2!=-1) {
-                    ShmState* s2 = (ShmState*)mmap(NULL, sizeof(ShmState), PROT_READ|PROT_WRITE, MAP_SHARED, fd2, 0);
-                    if (s2!=MAP_FAILED) {
-                        s2->station_done[stationIndex] = 0;
-                        munmap(s2, sizeof(ShmState));
-                    }
-                    ::close(fd2);
-                }
-            });
+    case EV_COMPLETED:
+        processedCount++;
+        counterLabel->setText(QString("📦 Productos Completados: %1").arg(processedCount));
+        // En modo observador no se registra cada producto: el log no debe
+        // convertirse en el cuello de botella de la GUI
+        if (!observerMode) {
+            onLogMessage(QString("✅ Producto #%1 finalizado. Total: %2").arg(productId).arg(processedCount));
+        }
 
-            onLogMessage(QString("🔄 Estación %1: GUI inició animación para producto #%2").arg(i+1).arg(productId));
+        if (processedCount % 5 == 0) {
+            showNotification(QString("¡%1 productos completados!").arg(processedCount), "success");
         }
+        break;
+
+    default:
+        break;
     }
+}
 
-    munmap(s, sizeof(ShmState));
-    ::close(fd);
+QString MainWindow::linePrefix(int line) const {
+    return lineCount > 1 ? QString("Línea %1, ").arg(line + 1) : QString();
 }
 
 void MainWindow::onLogMessage(const QString &msg) {
@@ -344,22 +548,15 @@ void MainWindow::onStatsUpdated(int productsProcessed, int threadsActive, int re
 }
 
 void MainWindow::onPauseClicked() {
-    controller->pauseStation(0);
+    for (int l = 0; l < lineCount; l++) controller->pauseStation(l, 0);
     onLogMessage("⏸️ UI: Pausa suave activada (estación 1 pausada)");
     showNotification("Producción pausada en Estación 1", "warning");
 }
 
 void MainWindow::onResumeClicked() {
-    controller->resumeStation(0);
+    for (int l = 0; l < lineCount; l++) controller->resumeStation(l, 0);
     onLogMessage("▶️ UI: Reanudado (estación 1)");
     showNotification("Producción reanudada", "success");
-
-    // DESPERTAR la estación 0 con un sem_post
-    sem_t* sem0 = open_sem_stage(0);
-    if (sem0) {
-        sem_post(sem0);
-        onLogMessage("🔔 Señal enviada a estación 0 para reanudar");
-    }
 }
 
 void MainWindow::onDeleteLotClicked() {
@@ -370,6 +567,8 @@ void MainWindow::onDeleteLotClicked() {
     controller->destroyIPC();
 
     processedCount = 0;  // ← CRÍTICO
+    journalCursor = JournalCursor();
+    reportedLostEvents = 0;
     counterLabel->setText("📦 Productos Completados: 0");
     logWidget->clear();
 
@@ -380,6 +579,7 @@ void MainWindow::onDeleteLotClicked() {
     QString path = QCoreApplication::applicationDirPath();
     QString filePath = path + "/app_state.json";
     QFile::remove(filePath);
+    QFile::remove(idStorePath());  // los IDs vuelven a empezar en 1
     onLogMessage("🗑️ Archivo de estado eliminado");
 
     if (!controller->initializeIPC()) {
@@ -392,25 +592,35 @@ void MainWindow::onDeleteLotClicked() {
         onLogMessage("⚠️ Warn: No se pudieron arrancar todos los procesos hijos.");
         showNotification("Advertencia: algunos procesos fallaron", "warning");
     } else {
+        updateLineToggleButton();
         onLogMessage("✅ UI: Reinicio completo, producción desde 0.");
         showNotification("Sistema reiniciado exitosamente", "success");
     }
 }
 
+// Los IDs son de 64 bits y un número JSON es un double (53 bits exactos):
+// se guardan como texto. Los archivos anteriores los tienen como número.
+static QJsonValue json_id(qint64 id) {
+    return QString::number(id);
+}
+
+static qint64 json_id(const QJsonValue &v) {
+    return v.isString() ? v.toString().toLongLong() : (qint64)v.toDouble();
+}
+
 void MainWindow::saveState() {
     QString path = QCoreApplication::applicationDirPath();
     QString filePath = path + "/app_state.json";
 
-    // Intentar abrir memoria compartida con timeout
-    int fd = shm_open(SHM_NAME, O_RDONLY, 0666);
-    if (fd == -1) {
+    ShmState* s = ipc_state();
+    if (!s) {
         qDebug() << "No se pudo abrir memoria compartida para guardar estado - continuando sin guardar productos en progreso";
 
         // Guardar al menos la información básica sin memoria compartida
         QJsonObject root;
         QJsonObject session;
         session["totalProductsFinished"] = processedCount;
-        session["nextProductId"] = processedCount + 1;
+        session["nextProductId"] = json_id((qint64)processedCount + 1);
         session["lastClosed"] = QDateTime::currentDateTime().toString(Qt::ISODate);
         root["sessionInfo"] = session;
         root["inProgressProducts"] = QJsonArray();
@@ -427,45 +637,81 @@ void MainWindow::saveState() {
         return;
     }
 
-    ShmState* s = (ShmState*)mmap(NULL, sizeof(ShmState), PROT_READ, MAP_SHARED, fd, 0);
-    if (s == MAP_FAILED) {
-        ::close(fd);
-        qDebug() << "mmap falló al guardar estado";
-        return;
-    }
+    // Copia coherente: un producto en plena transferencia no se guarda dos veces
+    ShmSnapshot snap;
+    ipc_snapshot(s, &snap);
 
     QJsonObject root;
 
     // Sesión info
     QJsonObject session;
     session["totalProductsFinished"] = processedCount;
-    session["nextProductId"] = s->next_product_id;
+    session["nextProductId"] = json_id((qint64)snap.next_product_id);
     session["lastClosed"] = QDateTime::currentDateTime().toString(Qt::ISODate);
     root["sessionInfo"] = session;
 
     // Productos en proceso - EVITAR DUPLICADOS
     QJsonArray inProgressArray;
-    QSet<int> seenProducts;
-
-    for (int i = 0; i < NUM_STATIONS; i++) {
-        int pid = s->product_in_station[i].productId;
-        if (pid > 0 && !seenProducts.contains(pid)) {
-            seenProducts.insert(pid);
-            QJsonObject prod;
-            prod["productId"] = pid;
-            prod["currentStation"] = i;
-            inProgressArray.append(prod);
+    QSet<qint64> seenProducts;
+
+    for (int i = 0; i < snap.total_stations; i++) {
+        for (int w = 0; w < snap.station_workers[i]; w++) {
+            qint64 pid = snap.product_in_worker[i * MAX_WORKERS + w].productId;
+            if (pid > 0 && !seenProducts.contains(pid)) {
+                seenProducts.insert(pid);
+                QJsonObject prod;
+                prod["productId"] = json_id(pid);
+                prod["currentLine"] = i / snap.station_count;
+                prod["currentStation"] = i % snap.station_count;
+                inProgressArray.append(prod);
+            }
+        }
+    }
+
+    // Productos en espera en las colas de entrada (la de la estación 0 la
+    // llena el despachador)
+    for (int i = 0; i < snap.total_stations; i++) {
+        for (int k = 0; k < snap.queued[i]; k++) {
+            qint64 pid = snap.queue[i * MAX_BUFFER_DEPTH + k].productId;
+            if (pid > 0 && !seenProducts.contains(pid)) {
+                seenProducts.insert(pid);
+                QJsonObject prod;
+                prod["productId"] = json_id(pid);
+                prod["currentLine"] = i / snap.station_count;
+                prod["currentStation"] = i % snap.station_count;
+                inProgressArray.append(prod);
+            }
         }
     }
     root["inProgressProducts"] = inProgressArray;
 
+    // Semilla y estado de cada generador: una sesión restaurada sigue las
+    // mismas secuencias de tiempos (los enteros de 64 bits van en hexa, un
+    // double de JSON no los representa)
+    QJsonObject rngObject;
+    rngObject["runSeed"] = QString::number(snap.run_seed);
+    QJsonArray rngArray;
+    for (int i = 0; i < snap.total_stations; i++) {
+        for (int w = 0; w < snap.station_workers[i]; w++) {
+            const ServiceRng &r = snap.worker_rng[i * MAX_WORKERS + w];
+            QJsonArray words;
+            for (int k = 0; k < 4; k++) words.append(QString::number(r.s[k], 16));
+            QJsonObject gen;
+            gen["line"] = i / snap.station_count;
+            gen["station"] = i % snap.station_count;
+            gen["worker"] = w;
+            gen["state"] = words;
+            if (r.hasSpare) gen["spare"] = r.spare;
+            rngArray.append(gen);
+        }
+    }
+    rngObject["workers"] = rngArray;
+    root["rng"] = rngObject;
+
     // Geometría
     QByteArray geo = saveGeometry();
     root["windowGeometry"] = QString::fromLatin1(geo.toBase64());
 
-    munmap(s, sizeof(ShmState));
-    ::close(fd);
-
     // Guardar archivo con formato compacto (más rápido)
     QFile file(filePath);
     if (file.open(QIODevice::WriteOnly)) {
@@ -473,12 +719,16 @@ void MainWindow::saveState() {
         file.write(doc.toJson(QJsonDocument::Compact));  // Compact en lugar de Indented
         file.close();
         onLogMessage(QString("💾 Estado guardado: %1 productos completados, NextID=%2")
-                         .arg(processedCount).arg(s->next_product_id));
+                         .arg(processedCount).arg(snap.next_product_id));
     } else {
         qWarning() << "No se pudo abrir archivo para guardar estado:" << filePath;
     }
 }
 
+QString MainWindow::idStorePath() const {
+    return QCoreApplication::applicationDirPath() + "/product_ids.hwm";
+}
+
 void MainWindow::loadState() {
     QString path = QCoreApplication::applicationDirPath();
     QString filePath = path + "/app_state.json";
@@ -509,17 +759,15 @@ void MainWindow::loadState() {
         }
 
         if (sessionInfoObject.contains("nextProductId")) {
-            int savedNextId = sessionInfoObject["nextProductId"].toInt();
-
-            // CORRECCIÓN CRÍTICA: next_product_id debe ser MAYOR que processedCount
-            // Si guardamos 7 completados, next_product_id debe ser mínimo 8
-            m_nextProductIdToRestore = qMax(processedCount + 1, savedNextId);
+            // Marca alta de IDs de la sesión anterior; el controlador la
+            // compara además con el archivo de IDs (persistido al reservar)
+            m_nextProductIdToRestore = json_id(sessionInfoObject["nextProductId"]);
 
             onLogMessage(QString("📊 Restaurando: Completados=%1, NextID=%2")
                              .arg(processedCount)
                              .arg(m_nextProductIdToRestore));
         } else {
-            // Si no hay nextProductId guardado, usar processedCount + 1
+            // Archivo antiguo sin nextProductId: el archivo de IDs manda
             m_nextProductIdToRestore = processedCount + 1;
         }
     }
@@ -534,12 +782,41 @@ void MainWindow::loadState() {
         for (const QJsonValue &val : inProgressArray) {
             QJsonObject productObject = val.toObject();
             if (productObject.contains("productId") && productObject.contains("currentStation")) {
-                int prodId = productObject["productId"].toInt();
+                qint64 prodId = json_id(productObject["productId"]);
                 int stationIdx = productObject["currentStation"].toInt();
-                m_productsToRestore.append({prodId, stationIdx});
-                onLogMessage(QString("📦 Producto %1 para restaurar en estación %2").arg(prodId).arg(stationIdx));
+                int lineIdx = productObject["currentLine"].toInt(0);  // archivos previos: una sola línea
+                if (lineIdx < 0 || lineIdx >= lineCount || stationIdx < 0 || stationIdx >= stationsPerLine) {
+                    onLogMessage(QString("⚠️ Producto %1 descartado: línea %2, estación %3 no existe")
+                                     .arg(prodId).arg(lineIdx + 1).arg(stationIdx + 1));
+                    continue;
+                }
+                m_productsToRestore.append({prodId, lineIdx * stationsPerLine + stationIdx});
+                onLogMessage(QString("📦 Producto %1 para restaurar en %2estación %3")
+                                 .arg(prodId).arg(linePrefix(lineIdx)).arg(stationIdx));
+            }
+        }
+    }
+
+    if (finalStateObject.contains("rng") && finalStateObject["rng"].isObject()) {
+        QJsonObject rngObject = finalStateObject["rng"].toObject();
+        quint64 seed = rngObject["runSeed"].toString().toULongLong();
+        QVector<ServiceRng> states(lineCount * stationsPerLine * MAX_WORKERS, ServiceRng{});
+        for (const QJsonValue &val : rngObject["workers"].toArray()) {
+            QJsonObject gen = val.toObject();
+            int lineIdx = gen["line"].toInt(-1);
+            int stationIdx = gen["station"].toInt(-1);
+            int w = gen["worker"].toInt(-1);
+            QJsonArray words = gen["state"].toArray();
+            if (lineIdx < 0 || lineIdx >= lineCount || stationIdx < 0 || stationIdx >= stationsPerLine ||
+                w < 0 || w >= MAX_WORKERS || words.size() != 4) {
+                continue;  // otra configuración: ese trabajador empieza su flujo de cero
             }
+            ServiceRng &r = states[(lineIdx * stationsPerLine + stationIdx) * MAX_WORKERS + w];
+            for (int k = 0; k < 4; k++) r.s[k] = words[k].toString().toULongLong(nullptr, 16);
+            r.hasSpare = gen.contains("spare");
+            r.spare = gen["spare"].toDouble();
         }
+        if (seed) controller->setRngCheckpoint(seed, states);
     }
 
     onLogMessage("✅ Estado de la aplicación cargado. Listo para restaurar la línea de producción.");
@@ -594,8 +871,8 @@ void MainWindow::closeEvent(QCloseEvent *event) {
 
     onLogMessage("🔴 Cerrando aplicación...");
 
-    // 1. Detener polling
-    pollTimer.stop();
+    // 1. Dejar de atender avisos de las estaciones
+    if (stationNotifier) stationNotifier->setEnabled(false);
 
     // 2. Guardar estado PRIMERO (lo más importante)
     saveState();
@@ -607,22 +884,21 @@ void MainWindow::closeEvent(QCloseEvent *event) {
 
     // 4. Matar procesos agresivamente SIN ESPERAR
     if (controller) {
-        int fd = shm_open(SHM_NAME, O_RDWR, 0666);
-        if (fd != -1) {
-            ShmState* s = (ShmState*)mmap(NULL, sizeof(ShmState), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
-            if (s != MAP_FAILED) {
-                s->running = 0;
-                munmap(s, sizeof(ShmState));
-            }
-            ::close(fd);
-        }
+        ShmState* s = ipc_state();
+        if (s) s->header.running = 0;
 
         // Matar TODOS los procesos hijos inmediatamente con SIGKILL
-        for (pid_t pid : controller->pids) {
-            if (pid > 0) {
-                kill(pid, SIGKILL);
+        for (const auto &pids : controller->linePids) {
+            for (pid_t pid : pids) {
+                if (pid > 0) {
+                    kill(pid, SIGKILL);
+                }
             }
         }
+        if (controller->dispatcherPid > 0) kill(controller->dispatcherPid, SIGKILL);
+
+        // Los hilos de estación no se pueden matar: se despiertan y se esperan
+        if (controller->usesThreads()) controller->stopAllLines();
 
         controller->destroyIPC();
     }
@@ -17,25 +17,34 @@
 #include <QDir>
 #include <QStandardPaths>
 #include <QPropertyAnimation>  // NUEVO
+#include <QSocketNotifier>
+#include <QComboBox>
+#include <QElapsedTimer>
 #include "productioncontroller.h"
 #include "threadmanager.h"
 #include "transportbeltwidget.h"
+#include "sim_config.h"
+#include "ipc_common.h"
 
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
 
 public:
-    explicit MainWindow(QWidget *parent = nullptr);
+    explicit MainWindow(const SimConfig &config = SimConfig(), QWidget *parent = nullptr);
     ~MainWindow();
 
 private slots:
     void onLineButtonClicked();
+    void onLineSelected(int line);
+    void onLineToggleClicked();
+    void onSpeedSelected(int index);
     void onPauseClicked();
     void onResumeClicked();
     void onShutdownClicked();
     void onDeleteLotClicked();
     void pollSharedMemory();
+    void onStationEvent();
     void onLogMessage(const QString &msg);
     void onStatsUpdated(int productsProcessed, int threadsActive, int resourcesUsed);
 
@@ -44,6 +53,9 @@ protected:
 
 private:
     void showNotification(const QString &message, const QString &type = "info");
+    void handleJournalEvent(const JournalRecord &ev);
+    void updateLineToggleButton();
+    QString linePrefix(int line) const;  // "Línea N, " solo con varias líneas
 
     QWidget *central;
     QVBoxLayout *mainLayout;
@@ -55,7 +67,18 @@ private:
 
     QStackedWidget *viewStack;
 
+    // Líneas paralelas: las páginas van línea por línea
+    int lineCount = 1;
+    int stationsPerLine = 1;
+    int currentLine = 0;
+    int currentStationView = 0;
+    QComboBox *lineSelector = nullptr;
+    QPushButton *lineToggleButton = nullptr;
+    QComboBox *policySelector = nullptr;    // política del despachador
+    QComboBox *speedSelector = nullptr;     // escala de tiempo de la simulación
+
     QVector<TransportBeltWidget*> belts;
+    QVector<QLabel*> bufferLabels;          // ocupación de la cola de entrada de cada estación
     QVector<QPushButton*> lineButtons;
 
     QWidget *bottomPanel;
@@ -71,14 +94,30 @@ private:
     ProductionController *controller;
     ThreadManager *threadManager;
 
-    QTimer pollTimer;
+    // Avisos de las estaciones (eventfd) en lugar de un timer de sondeo
+    QSocketNotifier *stationNotifier = nullptr;
+
+    // Modo observador (--observer): las estaciones no esperan a la GUI y las
+    // bandas solo muestran el último producto; los repasos se agrupan
+    bool observerMode = false;
+    QElapsedTimer refreshClock;           // último repaso de la bitácora
+    QTimer *refreshTimer = nullptr;       // repaso diferido cuando llegan avisos seguidos
+    QElapsedTimer beltClock;
+    QVector<qint64> lastDoneMs;           // último EV_DONE por estación (ms de beltClock)
+
+    // Posición propia en la bitácora de eventos de las estaciones
+    JournalCursor journalCursor;
+    quint64 reportedLostEvents = 0;
+    // Copia del estado que reutiliza cada repaso (sin reservar memoria)
+    ShmSnapshot pollSnap;
 
     int processedCount;
 
     void saveState();
     void loadState();
-    QList<QPair<int, int>> m_productsToRestore;
-    int m_nextProductIdToRestore = 1;
+    QList<QPair<qint64, int>> m_productsToRestore;
+    qint64 m_nextProductIdToRestore = 1;
+    QString idStorePath() const;
 };
 
 #endif // MAINWINDOW_H
@@ -3,18 +3,19 @@
 #include <unistd.h>
 #include <signal.h>
 #include <sys/wait.h>
+#include <spawn.h>
+#include <fcntl.h>
 #include <QDebug>
-#include <fcntl.h>        // O_CREAT, O_RDWR
-#include <sys/mman.h>     // shm_open, mmap, munmap, PROT_READ, PROT_WRITE, MAP_SHARED
-#include <sys/stat.h>     // S_IRUSR, S_IWUSR, mode flags
-#include <unistd.h>       // close()
-#include <semaphore.h>    // sem_open, sem_post, sem_wait
 #include <chrono>
+#include <cmath>
 #include <thread>
 #include <QList>
 #include <QPair>
 
-extern "C" void _child_entry(int idx, int seed); // station_child.cpp
+#include "station_child.h"
+#include "dispatcher.h"
+
+extern char **environ;
 
 ProductionController::ProductionController(QObject *parent) : QObject(parent), ipc_created(false) {}
 
@@ -29,51 +30,149 @@ bool ProductionController::initializeIPC() {
 }
 
 
-bool ProductionController::initializeIPC(int nextProductIdToRestore, const QList<QPair<int, int>>& productsToRestore) {
+void ProductionController::setRngCheckpoint(quint64 seed, const QVector<ServiceRng> &states) {
+    checkpointSeed = seed;
+    checkpointRngs = states;
+}
+
+bool ProductionController::initializeIPC(qint64 nextProductIdToRestore, const QList<QPair<qint64, int>>& productsToRestore) {
 
-    if (!create_ipc()) { emit logMessage("ERROR: create_ipc falló."); return false; }
+    // Con hilos el estado no necesita un objeto de memoria compartida
+    if (!create_ipc(config.lines, config.stations, config.bufferAt(0), !usesThreads())) {
+        emit logMessage("ERROR: create_ipc falló.");
+        return false;
+    }
     if (!open_ipc()) { emit logMessage("ERROR: El controlador no pudo abrir la IPC."); return false; }
 
-    int fd = shm_open(SHM_NAME, O_RDWR, 0666);
-    if (fd == -1) { emit logMessage("shm_open init fail"); return false; }
-    ShmState* s = (ShmState*)mmap(NULL, sizeof(ShmState), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
-    ::close(fd);
-    if (s == MAP_FAILED) { emit logMessage("mmap fail"); return false; }
+    ShmState* s = ipc_state();
+    if (!s) { emit logMessage("ERROR: memoria compartida sin mapear"); return false; }
 
-    s->running = 1;
+    s->header.running = 1;
+    int stations = s->header.station_count;
+    int total = s->total_stations();
+    linePids.assign(s->header.line_count, std::vector<pid_t>());
+    lineThreads.clear();
+    lineThreads.resize(s->header.line_count);
 
-    // LIMPIAR TODO
-    for (int i = 0; i < NUM_STATIONS; i++) {
-        s->station_done[i] = 0;
-        s->station_paused[i] = 0;
-        s->product_in_station[i].productId = 0;
+    // Dimensionar trabajadores, buffer y rutas de cada estación y limpiar
+    // todo (ipc_reset_line rearma las colas con la nueva capacidad)
+    for (int i = 0; i < total; i++) {
+        StationBlock& st = s->station(i);
+        st.worker_count = config.workersAt(i % stations);
+        st.buffer_depth = config.bufferAt(i % stations);
+        st.kanban_cards = config.kanbanAt(i % stations);
+        st.service = config.serviceAt(i % stations);
+        std::vector<int> next = config.routesAt(i % stations);
+        st.route_count = (int)next.size();
+        for (int k = 0; k < st.route_count; k++) st.routes[k] = (int16_t)next[k];
+    }
+    for (int l = 0; l < s->header.line_count; l++) ipc_reset_line(s, l);
+    s->header.ordered_output = config.ordered_output ? 1 : 0;
+    for (int i = 0; i < stations; i++) {
+        int depth = config.bufferAt(i);
+        // Con un grafo propio (--route) se muestra a dónde envía cada estación
+        QString route;
+        if (!config.routes.empty()) {
+            QStringList next;
+            for (int to : config.routesAt(i)) next << QString::number(to + 1);
+            route = next.isEmpty() ? QString(" → salida") : QString(" → %1").arg(next.join(" · "));
+        }
+        emit logMessage(QString("⏱️ Estación %1: %2, %3%4")
+                            .arg(i + 1).arg(QString::fromStdString(service_describe(config.serviceAt(i))))
+                            .arg(depth ? QString("buffer de %1").arg(depth) : QString("sin buffer"))
+                            .arg(route));
+    }
+    s->header.auto_ack = config.auto_ack ? 1 : 0;
+    s->header.release_policy = config.release_policy;
+    s->header.wip_limit = config.wipLimit();
+    if (config.release_policy == RELEASE_CONWIP) {
+        emit logMessage(QString("🚦 Liberación CONWIP: hasta %1 productos por línea").arg(s->header.wip_limit));
+    } else if (config.release_policy == RELEASE_KANBAN) {
+        QStringList cards;
+        for (int i = 0; i < stations; i++) cards << QString::number(config.kanbanAt(i));
+        emit logMessage(QString("🚦 Liberación kanban: tarjetas por estación %1").arg(cards.join(",")));
+    }
+
+    // Semilla de la corrida: --seed, la del archivo de estado o una nueva.
+    // Con ella cada trabajador deriva su propio flujo (station_run).
+    bool resume = checkpointSeed != 0 && (config.seed == 0 || config.seed == checkpointSeed);
+    currentSeed = config.seed ? config.seed : (checkpointSeed ? checkpointSeed : sim_random_seed());
+    s->header.run_seed = currentSeed;
+    if (resume) {
+        int restored = 0;
+        for (int i = 0; i < total && (i + 1) * MAX_WORKERS <= checkpointRngs.size(); i++) {
+            for (int w = 0; w < s->station(i).worker_count; w++) {
+                s->station(i).rngs[w].rng = checkpointRngs[i * MAX_WORKERS + w];
+                restored++;
+            }
+        }
+        emit logMessage(QString("🎲 Semilla de la corrida: %1 (restaurada, %2 generadores retomados)")
+                            .arg(currentSeed).arg(restored));
+    } else {
+        emit logMessage(QString("🎲 Semilla de la corrida: %1 (repetir con --seed=%1)").arg(currentSeed));
     }
+    checkpointSeed = 0;  // un reinicio empieza una corrida nueva
+    checkpointRngs.clear();
 
-    s->next_product_id = nextProductIdToRestore;
+    // Reanudar desde la marca alta persistida: cubre los bloques de IDs
+    // reservados aunque la sesión anterior terminara sin guardar su estado
+    if (!idStorePath.isEmpty()) {
+        qint64 highWater = id_store_open(idStorePath.toLocal8Bit().constData());
+        if (highWater < 0) {
+            emit logMessage("⚠️ No se pudo abrir el archivo de IDs: se usarán IDs sin persistir");
+        } else if (highWater > nextProductIdToRestore) {
+            emit logMessage(QString("🔢 Marca alta de IDs: %1").arg(highWater));
+            nextProductIdToRestore = highWater;
+        }
+    }
+    s->header.next_product_id = nextProductIdToRestore;
+    s->header.dispatch_policy = config.dispatch_policy;
+    ipc_set_speed(s, config.speed_x100);
 
-    // Restaurar productos si hay
+    // Restaurar productos si hay (pair.second es el índice global de la
+    // estación). Los primeros de cada estación vuelven a los slots de sus
+    // trabajadores; los demás quedan esperando en su cola de entrada.
+    QList<int> restoredAt;  // estaciones con productos restaurados en la cola
     for (const auto& pair : productsToRestore) {
-        if (pair.second >= 0 && pair.second < NUM_STATIONS) {
-            s->product_in_station[pair.second].productId = pair.first;
-            emit logMessage(QString("🔄 Restaurado producto %1 en estación %2")
-                                .arg(pair.first).arg(pair.second + 1));
+        int st = pair.second;
+        if (st < 0 || st >= total) continue;
+
+        ProductInfo p;
+        p.productId = pair.first;
+        StationBlock& block = s->station(st);
+        WorkerSlot* freeSlot = nullptr;
+        for (int w = 0; w < block.worker_count && !freeSlot; w++) {
+            if (block.workers[w].product.productId == 0) freeSlot = &block.workers[w];
+        }
+        if (freeSlot) {
+            freeSlot->product = p;
+        } else if (fsem_try_wait(&block.space_sem) && ring_push(&block.input, p)) {
+            restoredAt.append(st);
+        } else {
+            emit logMessage(QString("⚠️ Sin espacio para restaurar producto %1 en línea %2, estación %3")
+                                .arg(pair.first).arg(st / stations + 1).arg(st % stations + 1));
+            continue;
         }
+        // Con kanban el producto ocupa una tarjeta de su estación; si ya no
+        // quedan (otra configuración), la que devuelva al salir no cuenta
+        if (config.release_policy == RELEASE_KANBAN && !fsem_try_wait(&block.card_sem)) {
+            block.cards_owed.fetch_add(1);
+        }
+        s->line(st / stations).wip.fetch_add(1);
+        emit logMessage(QString("🔄 Restaurado producto %1 en línea %2, estación %3")
+                            .arg(pair.first).arg(st / stations + 1).arg(st % stations + 1));
     }
 
-    munmap(s, sizeof(ShmState));
-
-    if (productsToRestore.isEmpty()) {
-        emit logMessage("Enviando señal de inicio a la estación 0...");
-        sem_t* sem0 = open_sem_stage(0);
-        if (sem0) sem_post(sem0);
-    } else {
+    if (!restoredAt.isEmpty()) {
         emit logMessage("Enviando señales de restauración a las estaciones...");
-        for (const auto& pair : productsToRestore) {
-            sem_t* sem_stage = open_sem_stage(pair.second);
-            if (sem_stage) sem_post(sem_stage);
+        for (int st : restoredAt) {
+            fsem_post(&s->station(st).stage_sem);
         }
     }
 
+    // Los productos nuevos los crea el despachador (startAllLines) en
+    // cuanto alguna línea tiene lugar en la cola de su estación 0.
+
     ipc_created = true;
     emit logMessage("✅ IPC inicializado - Pipeline activado con limpieza segura");
     return true;
@@ -82,62 +181,232 @@ bool ProductionController::initializeIPC(int nextProductIdToRestore, const QList
 bool ProductionController::startAllLines() {
     if (!ipc_created) { emit logMessage("IPC not created"); return false; }
 
-    for (int i=0;i<NUM_STATIONS;i++) {
-        pid_t pid = fork();
-        if (pid < 0) {
-            emit logMessage(QString("fork failed for station %1").arg(i));
-            return false;
-        } else if (pid == 0) {
-            // child process
-            _child_entry(i, (int)getpid());
-            _exit(0);
-        } else {
-            pids.push_back(pid);
-            emit logMessage(QString("Forked station %1 pid=%2").arg(i).arg(pid));
-        }
+    for (int l = 0; l < lineCount(); l++) {
+        if (!startLine(l)) return false;
+    }
+
+    if (usesThreads()) {
+        dispatcherThread = std::thread(dispatcher_run);
+        emit logMessage(QString("Started dispatcher thread (política: %1)")
+                            .arg(dispatch_policy_name(ipc_state()->header.dispatch_policy)));
+        return true;
     }
+
+    pid_t pid = launchDispatcher();
+    if (pid < 0) {
+        emit logMessage("launch failed for dispatcher");
+        return false;
+    }
+    dispatcherPid = pid;
+    emit logMessage(QString("Started dispatcher pid=%1 (política: %2)")
+                        .arg(pid).arg(dispatch_policy_name(ipc_state()->header.dispatch_policy)));
     return true;
 }
 
-void ProductionController::stopAllLines() {
-    // Marcar como no running
-    int fd = shm_open(SHM_NAME, O_RDWR, 0666);
-    if (fd != -1) {
-        ShmState* s = (ShmState*)mmap(NULL, sizeof(ShmState), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
-        if (s!=MAP_FAILED) {
-            s->running = 0;
-            // Despertar semáforos para que los hijos salgan
-            for (int i=0;i<NUM_STATIONS;i++){
-                sem_t* st = open_sem_stage(i);
-                if (st) sem_post(st);
-                sem_t* ak = open_sem_ack(i);
-                if (ak) sem_post(ak);
+bool ProductionController::canSpawn() const {
+    return config.backend == BACKEND_SPAWN && !stationExecutable.isEmpty() &&
+           access(stationExecutable.toLocal8Bit().constData(), X_OK) == 0;
+}
+
+// Lanza el ejecutable `station` con los argumentos dados. Solo hereda el
+// eventfd de avisos (fd 3) y el archivo de IDs (fd 4); el resto de los
+// descriptores de la GUI (conexión al servidor gráfico, etc.) no pasan.
+pid_t ProductionController::spawnStation(const QStringList &args) {
+    // Copias por encima de 4: si el eventfd fuera el 4 o el archivo de IDs
+    // el 3, el primer dup2 pisaría el origen del segundo (y un dup2 sobre sí
+    // mismo no quitaría O_CLOEXEC)
+    int notifyFd = ipc_notify_fd() >= 0 ? fcntl(ipc_notify_fd(), F_DUPFD_CLOEXEC, 5) : -1;
+    int idFd = ipc_id_store_fd() >= 0 ? fcntl(ipc_id_store_fd(), F_DUPFD_CLOEXEC, 5) : -1;
+
+    QList<QByteArray> storage;
+    storage.append(stationExecutable.toLocal8Bit());
+    storage.append(QByteArray("--shm=") + ipc_name());
+    storage.append(QByteArray("--notify-fd=") + (notifyFd >= 0 ? "3" : "-1"));
+    storage.append(QByteArray("--id-fd=") + (idFd >= 0 ? "4" : "-1"));
+    for (const QString &a : args) storage.append(a.toLocal8Bit());
+    std::vector<char*> argv;
+    for (QByteArray &a : storage) argv.push_back(a.data());
+    argv.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    // dup2 quita O_CLOEXEC en el destino: son los únicos que sobreviven al exec
+    if (notifyFd >= 0) posix_spawn_file_actions_adddup2(&actions, notifyFd, 3);
+    if (idFd >= 0) posix_spawn_file_actions_adddup2(&actions, idFd, 4);
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 34))
+    posix_spawn_file_actions_addclosefrom_np(&actions, 5);
+#endif
+
+    pid_t pid = -1;
+    int rc = posix_spawn(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (notifyFd >= 0) ::close(notifyFd);
+    if (idFd >= 0) ::close(idFd);
+    return rc == 0 ? pid : -1;
+}
+
+pid_t ProductionController::launchWorker(int line, int idx, int worker) {
+    if (canSpawn()) {
+        return spawnStation({QString("--line=%1").arg(line), QString("--station=%1").arg(idx),
+                             QString("--worker=%1").arg(worker)});
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        // child process
+        _child_entry(line, idx, worker);
+        _exit(0);
+    }
+    return pid;
+}
+
+pid_t ProductionController::launchDispatcher() {
+    if (canSpawn()) return spawnStation({"--dispatcher"});
+    pid_t pid = fork();
+    if (pid == 0) {
+        _dispatcher_entry();
+        _exit(0);
+    }
+    return pid;
+}
+
+bool ProductionController::startLine(int line) {
+    if (!ipc_created) { emit logMessage("IPC not created"); return false; }
+    ShmState* s = ipc_state();
+    if (!s || line < 0 || line >= s->header.line_count) return false;
+    if (isLineRunning(line)) return true;  // ya está corriendo
+
+    // Una línea detenida antes vuelve a empezar vacía
+    if (!s->line(line).running) ipc_reset_line(s, line);
+
+    if (usesThreads()) {
+        // Un hilo por trabajador; comparten el estado del proceso
+        for (int i=0;i<s->header.station_count;i++) {
+            for (int w=0;w<s->station(line, i).worker_count;w++) {
+                lineThreads[line].emplace_back(station_run, line, i, w);
             }
-            munmap(s, sizeof(ShmState));
         }
-        ::close(fd);
+        emit logMessage(QString("Started line %1: %2 threads").arg(line).arg(lineThreads[line].size()));
+        ipc_wake_dispatcher(s);
+        return true;
     }
 
-    // Dar MENOS tiempo para salida graceful (reducido de 400ms a 100ms)
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    if (config.backend == BACKEND_SPAWN && !canSpawn()) {
+        emit logMessage(QString("⚠️ No se encontró %1: se usa fork()").arg(stationExecutable));
+    }
 
-    // Enviar SIGKILL directamente (más rápido que SIGTERM)
-    for (pid_t pid : pids) {
-        if (pid > 0) {
-            kill(pid, SIGKILL);  // SIGKILL en lugar de SIGTERM
+    // Un proceso por trabajador de cada estación
+    for (int i=0;i<s->header.station_count;i++) {
+        for (int w=0;w<s->station(line, i).worker_count;w++) {
+            pid_t pid = launchWorker(line, i, w);
+            if (pid < 0) {
+                emit logMessage(QString("launch failed for line %1 station %2 worker %3").arg(line).arg(i).arg(w));
+                return false;
+            }
+            linePids[line].push_back(pid);
+            emit logMessage(QString("Started line %1 station %2 worker %3 pid=%4")
+                                .arg(line).arg(i).arg(w).arg(pid));
+        }
+    }
+    ipc_wake_dispatcher(s);  // la línea vuelve a ser candidata
+    return true;
+}
+
+// Despertar semáforos para que los hijos de la línea salgan. Cada semáforo
+// recibe tantas señales como esperadores posibles (los hilos no se pueden
+// matar: todos deben despertar); al volver a arrancar la línea se reinicia.
+void ProductionController::wakeLine(ShmState* s, int line) {
+    for (int i=0;i<s->header.station_count;i++){
+        StationBlock& st = s->station(line, i);
+        for (int w=0;w<MAX_WORKERS;w++){
+            fsem_post(&st.stage_sem);
+            fsem_post(&st.space_sem);
+            fsem_post(&st.card_sem);
         }
+        for (int w=0;w<st.worker_count;w++){
+            fsem_post(&st.workers[w].ack_sem);
+        }
+        futex_wake_word(&st.paused);
+        futex_wake_word(&st.out_turn);
     }
+}
 
-    // Waitpid sin bloquear indefinidamente
+// Espera a que los procesos ya despertados salgan solos (sin dejar zombis)
+// y mata con SIGKILL a los que no lo hagan en un tiempo acotado. Devuelve
+// cuántos hubo que matar
+static int reap_processes(std::vector<pid_t> &pids) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+    for (;;) {
+        bool alive = false;
+        for (pid_t &pid : pids) {
+            if (pid > 0 && waitpid(pid, nullptr, WNOHANG) != 0) pid = 0;
+            alive = alive || pid > 0;
+        }
+        if (!alive || std::chrono::steady_clock::now() >= deadline) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    int killed = 0;
     for (pid_t pid : pids) {
         if (pid > 0) {
-            int status = 0;
-            waitpid(pid, &status, WNOHANG);  // WNOHANG = no bloquear
+            kill(pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+            killed++;
+        }
+    }
+    return killed;
+}
+
+void ProductionController::reapLine(int line) {
+    // Hilos: ya despertados por wakeLine, salen solos
+    for (std::thread &t : lineThreads[line]) {
+        if (t.joinable()) t.join();
+    }
+    lineThreads[line].clear();
+
+    // Un proceso muerto con SIGKILL pudo quedar dentro de station_lock: su
+    // seqlock impar dejaría a ipc_snapshot esperando en cada lectura
+    ShmState* s = ipc_state();
+    if (reap_processes(linePids[line]) > 0 && s) ipc_release_line_locks(s, line);
+    linePids[line].clear();
+}
+
+void ProductionController::stopLine(int line) {
+    ShmState* s = ipc_state();
+    if (!s || line < 0 || line >= s->header.line_count || line >= (int)linePids.size()) return;
+
+    s->line(line).running = 0;
+    wakeLine(s, line);
+    ipc_wake_dispatcher(s);
+    reapLine(line);
+    emit logMessage(QString("⏹️ Línea %1 detenida").arg(line + 1));
+}
+
+bool ProductionController::isLineRunning(int line) const {
+    if (line < 0) return false;
+    if (usesThreads()) return line < (int)lineThreads.size() && !lineThreads[line].empty();
+    return line < (int)linePids.size() && !linePids[line].empty();
+}
+
+void ProductionController::stopAllLines() {
+    // Marcar como no running
+    ShmState* s = ipc_state();
+    if (s) {
+        s->header.running = 0;
+        for (int l = 0; l < s->header.line_count; l++) {
+            wakeLine(s, l);
         }
+        ipc_wake_dispatcher(s);
     }
 
-    pids.clear();
-    emit logMessage("✅ Procesos hijos terminados");
+    for (int l = 0; l < (int)linePids.size(); l++) {
+        reapLine(l);
+    }
+    if (dispatcherThread.joinable()) dispatcherThread.join();
+    if (dispatcherPid > 0) {
+        std::vector<pid_t> dispatcher = {dispatcherPid};
+        reap_processes(dispatcher);
+        dispatcherPid = -1;
+    }
+    emit logMessage(usesThreads() ? "✅ Hilos de estaciones terminados" : "✅ Procesos hijos terminados");
 }
 void ProductionController::restartAllLines() {
     emit logMessage("Restarting all lines...");
@@ -145,7 +414,6 @@ void ProductionController::restartAllLines() {
     // destroy and re-create IPC and children
     destroy_ipc();
     ipc_created = false;
-    std::this_thread::sleep_for(std::chrono::milliseconds(300));
     if (!initializeIPC()) {
         emit logMessage("Failed to initialize IPC on restart");
         return;
@@ -163,33 +431,65 @@ void ProductionController::destroyIPC() {
     emit logMessage("Destroyed IPC");
 }
 
-void ProductionController::pauseStation(int idx) {
-    int fd = shm_open(SHM_NAME, O_RDWR, 0666);
-    if (fd == -1) return;
-    ShmState* s = (ShmState*)mmap(NULL, sizeof(ShmState), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
-    if (s!=MAP_FAILED) {
-        s->station_paused[idx] = 1;
-        munmap(s, sizeof(ShmState));
-    }
-    ::close(fd);
-    emit logMessage(QString("Paused station %1").arg(idx));
+void ProductionController::setDispatchPolicy(int policy) {
+    ShmState* s = ipc_state();
+    if (!s || policy < 0 || policy >= DISPATCH_POLICY_COUNT) return;
+    config.dispatch_policy = policy;
+    s->header.dispatch_policy = policy;
+    ipc_wake_dispatcher(s);
+    emit logMessage(QString("🔀 Política de despacho: %1").arg(dispatch_policy_name(policy)));
 }
 
-void ProductionController::resumeStation(int idx) {
-    int fd = shm_open(SHM_NAME, O_RDWR, 0666);
-    if (fd == -1) return;
-    ShmState* s = (ShmState*)mmap(NULL, sizeof(ShmState), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
-    if (s!=MAP_FAILED) {
-        s->station_paused[idx] = 0;
-        munmap(s, sizeof(ShmState));
+void ProductionController::setTimeScale(double scale) {
+    ShmState* s = ipc_state();
+    if (!s) return;
+    ipc_set_speed(s, (int)lround(scale * 100));
+    config.speed_x100 = s->header.speed_x100;
+    emit logMessage(QString("⏱️ Escala de tiempo: %1×").arg(config.speed_x100 / 100.0));
+}
+
+double ProductionController::timeScale() const {
+    ShmState* s = ipc_state();
+    return (s ? s->header.speed_x100.load() : config.speed_x100) / 100.0;
+}
+
+int ProductionController::lineCount() const {
+    ShmState* s = ipc_state();
+    return s ? s->header.line_count : 0;
+}
+
+int ProductionController::stationCount() const {
+    ShmState* s = ipc_state();
+    return s ? s->header.station_count : 0;
+}
+
+void ProductionController::pauseStation(int line, int idx) {
+    ShmState* s = ipc_state();
+    if (!s || line < 0 || line >= s->header.line_count || idx < 0 || idx >= s->header.station_count) return;
+    StationBlock& st = s->station(line, idx);
+    st.paused = 1;
+    // Sin buffer los trabajadores libres tienen un crédito ofrecido: se los
+    // despierta para que lo retiren (station_run) y no entre nada pausada
+    if (st.buffer_depth == 0) {
+        for (int w = 0; w < st.worker_count; w++) fsem_post(&st.stage_sem);
     }
-    ::close(fd);
-    emit logMessage(QString("Resumed station %1").arg(idx));
+    emit logMessage(QString("Paused line %1 station %2").arg(line).arg(idx));
+}
+
+void ProductionController::resumeStation(int line, int idx) {
+    ShmState* s = ipc_state();
+    if (!s || line < 0 || line >= s->header.line_count || idx < 0 || idx >= s->header.station_count) return;
+    s->station(line, idx).paused = 0;
+    futex_wake_word(&s->station(line, idx).paused);
+    if (idx == 0) ipc_wake_dispatcher(s);  // la línea vuelve a admitir productos
+    emit logMessage(QString("Resumed line %1 station %2").arg(line).arg(idx));
 }
 
 void ProductionController::pauseAllStations() {
-    for (int i = 0; i < NUM_STATIONS; ++i) {
-        pauseStation(i);
+    for (int l = 0; l < lineCount(); ++l) {
+        for (int i = 0; i < stationCount(); ++i) {
+            pauseStation(l, i);
+        }
     }
     emit logMessage("Todas las estaciones han sido pausadas.");
 }
@@ -3,10 +3,18 @@
 
 #include <QObject>
 #include <vector>
+#include <thread>
 #include <sys/types.h>
 
 #include <QList>
 #include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "sim_config.h"
+
+struct ShmState;
+
 class ProductionController : public QObject
 {
     Q_OBJECT
@@ -15,24 +23,68 @@ public:
     ~ProductionController();
 
     bool initializeIPC(); // Para arrancar desde cero
-    bool initializeIPC(int nextProductIdToRestore, const QList<QPair<int, int>>& productsToRestore); // Para restaurar
+    bool initializeIPC(qint64 nextProductIdToRestore, const QList<QPair<qint64, int>>& productsToRestore); // Para restaurar
 
     bool startAllLines();
     void stopAllLines();
+    // Cada línea se arranca y detiene por separado; al arrancar de nuevo una
+    // línea detenida empieza vacía (sus productos en curso se descartan)
+    bool startLine(int line);
+    void stopLine(int line);
+    bool isLineRunning(int line) const;
     void restartAllLines(); // nuevo: detiene, destruye IPC, reinicia todo
     void destroyIPC();
 
-    void pauseStation(int idx);
-    void resumeStation(int idx);
+    void pauseStation(int line, int idx);
+    void resumeStation(int line, int idx);
 
     void pauseAllStations();
 
+    // Política del despachador (DispatchPolicy); se aplica en marcha
+    void setDispatchPolicy(int policy);
+    // Escala de tiempo de estaciones y animaciones (1.0 = tiempo real); en marcha
+    void setTimeScale(double scale);
+    double timeScale() const;
+
+    void setConfig(const SimConfig &cfg) { config = cfg; }
+    // Semilla y generadores guardados en el archivo de estado
+    // (states[i * MAX_WORKERS + w]); initializeIPC los retoma si la corrida
+    // no pide otra semilla con --seed
+    void setRngCheckpoint(quint64 seed, const QVector<ServiceRng> &states);
+    quint64 runSeed() const { return currentSeed; }  // la de la corrida actual
+    // Archivo con la marca alta de IDs; initializeIPC nunca reparte IDs por debajo
+    void setIdStorePath(const QString &path) { idStorePath = path; }
+    int lineCount() const;     // leídos de la cabecera de la IPC
+    int stationCount() const;  // estaciones por línea
+    // Backend de hilos (--backend=thread): mismas operaciones, sin fork()
+    bool usesThreads() const { return config.backend == BACKEND_THREAD; }
+    // Ejecutable `station` (sin Qt) que se lanza con posix_spawn; si no
+    // existe, las estaciones se crean con fork() de la GUI
+    void setStationExecutable(const QString &path) { stationExecutable = path; }
+
+private:
+    void wakeLine(ShmState* s, int line);
+    void reapLine(int line);
+    bool canSpawn() const;
+    pid_t spawnStation(const QStringList &args);  // -1 si falla
+    pid_t launchWorker(int line, int idx, int worker);
+    pid_t launchDispatcher();
+
 signals:
     void logMessage(const QString &msg);
 
 public:
-    std::vector<pid_t> pids;
+    std::vector<std::vector<pid_t>> linePids;  // procesos de cada línea
+    pid_t dispatcherPid = -1;
+    std::vector<std::vector<std::thread>> lineThreads;  // backend de hilos
+    std::thread dispatcherThread;
+    QString idStorePath;
+    QString stationExecutable;
+    quint64 currentSeed = 0;
+    quint64 checkpointSeed = 0;
+    QVector<ServiceRng> checkpointRngs;
      bool ipc_created;
+    SimConfig config;
 };
 
 #endif // PRODUCTIONCONTROLLER_H
@@ -0,0 +1,203 @@
+#include "service_time.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+ServiceModel service_default() {
+    ServiceModel m;
+    memset(&m, 0, sizeof(m));
+    m.kind = SVC_UNIFORM;
+    m.a = 800;
+    m.b = 1600;
+    return m;
+}
+
+// Construye la tabla de cuantiles a partir de una muestra ordenada
+static void build_table(ServiceModel* m, const std::vector<double>& sorted) {
+    size_t n = sorted.size();
+    for (int k = 0; k <= SERVICE_TABLE_SIZE; k++) {
+        double pos = (double)k / SERVICE_TABLE_SIZE * (n - 1);
+        size_t i = (size_t)pos;
+        double frac = pos - i;
+        double v = i + 1 < n ? sorted[i] + (sorted[i + 1] - sorted[i]) * frac : sorted[i];
+        m->table[k] = (float)v;
+    }
+}
+
+static bool load_empirical(const char* path, ServiceModel* m, std::string* error) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        if (error) *error = std::string("no se pudo abrir ") + path;
+        return false;
+    }
+    std::vector<double> samples;
+    double v;
+    while (fscanf(f, "%lf", &v) == 1) {
+        if (v >= 0) samples.push_back(v);
+    }
+    fclose(f);
+    if (samples.empty()) {
+        if (error) *error = std::string("sin tiempos en ") + path;
+        return false;
+    }
+    std::sort(samples.begin(), samples.end());
+    build_table(m, samples);
+    double sum = 0;
+    for (double x : samples) sum += x;
+    m->a = sum / samples.size();  // media, solo informativa
+    m->b = (double)samples.size();
+    return true;
+}
+
+bool service_parse(const char* spec, ServiceModel* out, std::string* error) {
+    ServiceModel m;
+    memset(&m, 0, sizeof(m));
+    const char* colon = strchr(spec, ':');
+    std::string kind = colon ? std::string(spec, colon - spec) : std::string(spec);
+    const char* args = colon ? colon + 1 : "";
+
+    double a = 0, b = 0;
+    int n = sscanf(args, "%lf:%lf", &a, &b);
+    bool ok = true;
+    if (kind == "fixed") {
+        m.kind = SVC_FIXED;
+        ok = n >= 1 && a >= 0;
+    } else if (kind == "uniform") {
+        m.kind = SVC_UNIFORM;
+        ok = n == 2 && a >= 0 && b >= a;
+    } else if (kind == "normal") {
+        m.kind = SVC_NORMAL;
+        ok = n == 2 && a >= 0 && b >= 0;
+    } else if (kind == "lognormal") {
+        m.kind = SVC_LOGNORMAL;
+        ok = n == 2 && a > 0 && b >= 0;
+    } else if (kind == "exp") {
+        m.kind = SVC_EXPONENTIAL;
+        ok = n >= 1 && a > 0;
+    } else if (kind == "empirical") {
+        m.kind = SVC_EMPIRICAL;
+        if (!load_empirical(args, &m, error)) return false;
+        *out = m;
+        return true;
+    } else {
+        if (error) *error = "modelo desconocido: " + kind;
+        return false;
+    }
+    if (!ok) {
+        if (error) *error = std::string("parámetros inválidos: ") + spec;
+        return false;
+    }
+    m.a = a;
+    m.b = b;
+    if (m.kind == SVC_LOGNORMAL) {
+        // Parámetros de la normal subyacente a partir de media y desvío
+        double s2 = std::log(1.0 + (b * b) / (a * a));
+        m.a = std::log(a) - s2 / 2;
+        m.b = std::sqrt(s2);
+    }
+    *out = m;
+    return true;
+}
+
+std::string service_describe(const ServiceModel& m) {
+    char buf[96];
+    switch (m.kind) {
+    case SVC_FIXED:       snprintf(buf, sizeof(buf), "fijo %.0f ms", m.a); break;
+    case SVC_UNIFORM:     snprintf(buf, sizeof(buf), "uniforme %.0f-%.0f ms", m.a, m.b); break;
+    case SVC_NORMAL:      snprintf(buf, sizeof(buf), "normal %.0f±%.0f ms", m.a, m.b); break;
+    case SVC_LOGNORMAL:
+        snprintf(buf, sizeof(buf), "lognormal media %.0f ms", std::exp(m.a + m.b * m.b / 2));
+        break;
+    case SVC_EXPONENTIAL: snprintf(buf, sizeof(buf), "exponencial media %.0f ms", m.a); break;
+    case SVC_EMPIRICAL:
+        snprintf(buf, sizeof(buf), "empírico media %.0f ms (%.0f muestras)", m.a, m.b);
+        break;
+    default:              snprintf(buf, sizeof(buf), "?"); break;
+    }
+    return buf;
+}
+
+static inline uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+void service_rng_seed(ServiceRng* rng, uint64_t seed) {
+    // splitmix64 para repartir la semilla en los cuatro estados
+    for (int i = 0; i < 4; i++) {
+        uint64_t z = (seed += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        rng->s[i] = z ^ (z >> 31);
+    }
+    rng->spare = 0;
+    rng->hasSpare = false;
+}
+
+void service_rng_stream(ServiceRng* rng, uint64_t seed, uint64_t stream) {
+    // El número de flujo pasa por el finalizador de splitmix64 antes de
+    // combinarse: flujos vecinos (estaciones contiguas) quedan con semillas
+    // sin relación entre sí y la siembra no depende de cuántos flujos haya
+    uint64_t z = (stream + 1) * 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    service_rng_seed(rng, seed ^ z ^ (z >> 31));
+}
+
+uint64_t service_rng_next(ServiceRng* rng) {
+    uint64_t* s = rng->s;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+// Uniforme en [0, 1) con 53 bits
+static inline double uniform01(ServiceRng* rng) {
+    return (service_rng_next(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Normal estándar (Box-Muller; cada par de uniformes da dos valores)
+static double standard_normal(ServiceRng* rng) {
+    if (rng->hasSpare) {
+        rng->hasSpare = false;
+        return rng->spare;
+    }
+    double u1 = 1.0 - uniform01(rng);  // (0, 1]: log finito
+    double u2 = uniform01(rng);
+    double r = std::sqrt(-2.0 * std::log(u1));
+    double theta = 6.283185307179586 * u2;
+    rng->spare = r * std::sin(theta);
+    rng->hasSpare = true;
+    return r * std::cos(theta);
+}
+
+double service_sample_ms(const ServiceModel& m, ServiceRng* rng) {
+    switch (m.kind) {
+    case SVC_FIXED:
+        return m.a;
+    case SVC_UNIFORM:
+        return m.a + (m.b - m.a) * uniform01(rng);
+    case SVC_NORMAL:
+        return std::max(0.0, m.a + m.b * standard_normal(rng));
+    case SVC_LOGNORMAL:
+        return std::exp(m.a + m.b * standard_normal(rng));
+    case SVC_EXPONENTIAL:
+        return -m.a * std::log(1.0 - uniform01(rng));
+    case SVC_EMPIRICAL: {
+        double pos = uniform01(rng) * SERVICE_TABLE_SIZE;
+        int i = (int)pos;
+        return m.table[i] + (m.table[i + 1] - m.table[i]) * (pos - i);
+    }
+    default:
+        return 0;
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef SERVICE_TIME_H
+#define SERVICE_TIME_H
+
+#include <cstdint>
+#include <string>
+
+// Modelos de tiempo de servicio (trabajo) de una estación. Se guardan en el
+// bloque de cada estación en memoria compartida, así que son POD: el modelo
+// empírico lleva su tabla de cuantiles adentro y los procesos de estación
+// nunca leen archivos.
+
+enum ServiceKind {
+    SVC_FIXED = 0,     // a ms
+    SVC_UNIFORM,       // a..b ms
+    SVC_NORMAL,        // media a, desvío b (ms), recortada en 0
+    SVC_LOGNORMAL,     // media a, desvío b (ms) del propio tiempo
+    SVC_EXPONENTIAL,   // media a ms
+    SVC_EMPIRICAL      // tabla de cuantiles de tiempos medidos
+};
+
+// Cuantiles 0, 1/N, ..., 1 de la muestra empírica; se interpola entre ellos
+#define SERVICE_TABLE_SIZE 128
+
+struct ServiceModel {
+    int32_t kind;
+    double a;
+    double b;
+    float table[SERVICE_TABLE_SIZE + 1];
+};
+
+// Modelo por omisión: el histórico 800 + rand() % 800 ms
+ServiceModel service_default();
+
+// Lee "fixed:MS", "uniform:MIN:MAX", "normal:MEDIA:DESVÍO",
+// "lognormal:MEDIA:DESVÍO", "exp:MEDIA" o "empirical:ARCHIVO" (tiempos en
+// ms separados por espacios o líneas). Devuelve false y un mensaje si falla.
+bool service_parse(const char* spec, ServiceModel* out, std::string* error);
+std::string service_describe(const ServiceModel& m);
+
+// xoshiro256**: generador por trabajador, unos pocos ns por número
+struct ServiceRng {
+    uint64_t s[4];
+    double spare;       // segundo normal de Box-Muller
+    bool hasSpare;
+};
+
+void service_rng_seed(ServiceRng* rng, uint64_t seed);
+// Flujo número `stream` de la corrida `seed`: cada trabajador de cada
+// estación tiene el suyo, así que sus tiempos no cambian con el resto de la
+// configuración ni con el orden en que el sistema operativo reparte la CPU
+void service_rng_stream(ServiceRng* rng, uint64_t seed, uint64_t stream);
+uint64_t service_rng_next(ServiceRng* rng);
+
+// Muestra un tiempo de servicio en ms (>= 0)
+double service_sample_ms(const ServiceModel& m, ServiceRng* rng);
+
+#endif // SERVICE_TIME_H
@@ -0,0 +1,166 @@
+#include "sim_config.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include <unistd.h>
+
+// Devuelve el valor de la opción "name" si argv[i] la contiene
+// ("--name=valor" o "--name valor"), avanzando i en el segundo caso.
+static const char* option_value(int argc, char *argv[], int &i, const char *name) {
+    size_t len = strlen(name);
+    const char *arg = argv[i];
+    if (strncmp(arg, name, len) != 0) return nullptr;
+    if (arg[len] == '=') return arg + len + 1;
+    if (arg[len] == '\0' && i + 1 < argc) return argv[++i];
+    return nullptr;
+}
+
+static int clamp_int(long v, int lo, int hi) {
+    if (v < lo) return lo;
+    if (v > hi) return hi;
+    return (int)v;
+}
+
+// Lista separada por comas ("1,3,1"): un valor por estación, acotado a lo..hi
+static std::vector<int> int_list(const char *v, int lo, int hi) {
+    std::vector<int> values;
+    for (const char *p = v; *p; ) {
+        char *end;
+        long n = strtol(p, &end, 10);
+        if (end == p) break;
+        values.push_back(clamp_int(n, lo, hi));
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return values;
+}
+
+// Aristas "desde:hasta" separadas por comas, estaciones numeradas desde 1
+static std::vector<std::pair<int, int>> edge_list(const char *v) {
+    std::vector<std::pair<int, int>> edges;
+    for (const char *p = v; *p; ) {
+        char *end;
+        long from = strtol(p, &end, 10);
+        if (end == p || *end != ':') break;
+        const char *q = end + 1;
+        long to = strtol(q, &end, 10);
+        if (end == q) break;
+        edges.push_back({(int)from - 1, (int)to - 1});
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return edges;
+}
+
+// Arma la tabla de adyacencia con las aristas válidas: solo hacia adelante
+// (sin ciclos, la estación 0 es la única entrada) y hasta MAX_ROUTES por
+// estación. Se hace al final porque --stations puede venir después.
+static void build_routes(const std::vector<std::pair<int, int>> &edges, SimConfig &cfg) {
+    cfg.routes.assign(cfg.stations, std::vector<int>());
+    std::vector<int> fed(cfg.stations, 0);
+    for (const auto &e : edges) {
+        int from = e.first, to = e.second;
+        if (from < 0 || to >= cfg.stations || to <= from) {
+            fprintf(stderr, "--route: %d:%d ignorada (debe ir a una estación posterior que exista)\n",
+                    from + 1, to + 1);
+            continue;
+        }
+        std::vector<int> &next = cfg.routes[from];
+        if (std::find(next.begin(), next.end(), to) != next.end()) continue;
+        if ((int)next.size() >= MAX_ROUTES) {
+            fprintf(stderr, "--route: la estación %d ya tiene %d sucesoras, %d:%d ignorada\n",
+                    from + 1, MAX_ROUTES, from + 1, to + 1);
+            continue;
+        }
+        next.push_back(to);
+        fed[to] = 1;
+    }
+    for (int i = 1; i < cfg.stations; i++) {
+        if (!fed[i]) fprintf(stderr, "--route: la estación %d no recibe productos\n", i + 1);
+    }
+}
+
+void parse_sim_args(int argc, char *argv[], SimConfig &cfg) {
+    std::vector<std::pair<int, int>> edges;
+    bool routed = false;
+    for (int i = 1; i < argc; i++) {
+        const char *v = nullptr;
+        if ((v = option_value(argc, argv, i, "--lines"))) {
+            cfg.lines = clamp_int(strtol(v, nullptr, 10), 1, MAX_LINES);
+        } else if ((v = option_value(argc, argv, i, "--stations"))) {
+            cfg.stations = clamp_int(strtol(v, nullptr, 10), 1, MAX_STATIONS);
+        } else if ((v = option_value(argc, argv, i, "--buffer"))) {
+            std::vector<int> depths = int_list(v, 0, MAX_BUFFER_DEPTH);
+            if (!depths.empty()) cfg.buffer_depth = depths;
+        } else if ((v = option_value(argc, argv, i, "--policy"))) {
+            if (strcmp(v, "rr") == 0) cfg.dispatch_policy = DISPATCH_ROUND_ROBIN;
+            else if (strcmp(v, "jsq") == 0) cfg.dispatch_policy = DISPATCH_SHORTEST_QUEUE;
+            else if (strcmp(v, "least") == 0) cfg.dispatch_policy = DISPATCH_LEAST_LOADED;
+        } else if ((v = option_value(argc, argv, i, "--workers"))) {
+            std::vector<int> workers = int_list(v, 1, MAX_WORKERS);
+            if (!workers.empty()) cfg.workers = workers;
+        } else if ((v = option_value(argc, argv, i, "--backend"))) {
+            if (strcmp(v, "spawn") == 0) cfg.backend = BACKEND_SPAWN;
+            else if (strcmp(v, "fork") == 0) cfg.backend = BACKEND_FORK;
+            else if (strcmp(v, "thread") == 0) cfg.backend = BACKEND_THREAD;
+        } else if ((v = option_value(argc, argv, i, "--service"))) {
+            // Un modelo por estación separado por comas (ver service_parse)
+            std::vector<ServiceModel> models;
+            std::string list(v);
+            size_t pos = 0;
+            while (pos <= list.size()) {
+                size_t comma = list.find(',', pos);
+                std::string spec = list.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+                ServiceModel m;
+                std::string error;
+                if (service_parse(spec.c_str(), &m, &error)) {
+                    models.push_back(m);
+                } else {
+                    fprintf(stderr, "--service: %s\n", error.c_str());
+                    models.push_back(models.empty() ? service_default() : models.back());
+                }
+                if (comma == std::string::npos) break;
+                pos = comma + 1;
+            }
+            if (!models.empty()) cfg.service = models;
+        } else if (strcmp(argv[i], "--ordered") == 0) {
+            cfg.ordered_output = true;
+        } else if (strcmp(argv[i], "--auto-ack") == 0 || strcmp(argv[i], "--observer") == 0) {
+            cfg.auto_ack = true;
+        } else if ((v = option_value(argc, argv, i, "--time-scale"))) {
+            cfg.speed_x100 = clamp_int(lround(strtod(v, nullptr) * 100), SPEED_MIN_X100, SPEED_MAX_X100);
+        } else if ((v = option_value(argc, argv, i, "--duration"))) {
+            double d = strtod(v, nullptr);
+            cfg.duration_s = d > 0 ? d : 0;
+        } else if ((v = option_value(argc, argv, i, "--release"))) {
+            if (strcmp(v, "push") == 0) cfg.release_policy = RELEASE_PUSH;
+            else if (strcmp(v, "conwip") == 0) cfg.release_policy = RELEASE_CONWIP;
+            else if (strcmp(v, "kanban") == 0) cfg.release_policy = RELEASE_KANBAN;
+        } else if ((v = option_value(argc, argv, i, "--wip"))) {
+            cfg.wip_limit = clamp_int(strtol(v, nullptr, 10), 1, MAX_STATIONS * (MAX_WORKERS + MAX_BUFFER_DEPTH));
+        } else if ((v = option_value(argc, argv, i, "--kanban"))) {
+            std::vector<int> cards = int_list(v, 1, MAX_KANBAN_CARDS);
+            if (!cards.empty()) cfg.kanban = cards;
+        } else if ((v = option_value(argc, argv, i, "--route"))) {
+            std::vector<std::pair<int, int>> more = edge_list(v);
+            edges.insert(edges.end(), more.begin(), more.end());
+            routed = true;
+        } else if ((v = option_value(argc, argv, i, "--seed"))) {
+            cfg.seed = strtoull(v, nullptr, 0);
+        }
+    }
+    if (routed) build_routes(edges, cfg);
+    // El total de bloques de estación está acotado: se recortan las líneas
+    if (cfg.lines * cfg.stations > MAX_STATIONS) cfg.lines = MAX_STATIONS / cfg.stations;
+}
+
+uint64_t sim_random_seed() {
+    // Reloj y pid mezclados: dos corridas lanzadas a la vez no coinciden
+    uint64_t z = ipc_now_ns() ^ ((uint64_t)getpid() << 32);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    z ^= z >> 31;
+    return z ? z : 1;
+}
@@ -0,0 +1,83 @@
+#ifndef SIM_CONFIG_H
+#define SIM_CONFIG_H
+
+#include "ipc_common.h"
+#include <vector>
+
+// Cómo corren las estaciones y el despachador
+enum StationBackend {
+    BACKEND_SPAWN = 0,  // un proceso `station` por trabajador (posix_spawn, sin Qt)
+    BACKEND_FORK,       // un fork() de la GUI por trabajador (memoria compartida POSIX)
+    BACKEND_THREAD      // un hilo por trabajador dentro del proceso de la GUI
+};
+
+// Parámetros de la simulación que se fijan al arrancar (línea de comandos)
+struct SimConfig {
+    int lines = DEFAULT_LINES;                // líneas paralelas (1..MAX_LINES)
+    int stations = DEFAULT_STATIONS;          // estaciones por línea (1..MAX_STATIONS)
+    // Capacidad de la cola de entrada de cada estación (la de la estación 0
+    // la llena el despachador), 0..MAX_BUFFER_DEPTH; 0 = entrega directa.
+    // Las estaciones sin valor usan el último de la lista.
+    std::vector<int> buffer_depth = {DEFAULT_BUFFER_DEPTH};
+    int dispatch_policy = DISPATCH_ROUND_ROBIN;  // reparto de productos entre líneas
+    // Trabajadores por estación (índice dentro de la línea, igual en todas
+    // las líneas); las estaciones sin valor usan el último de la lista
+    std::vector<int> workers = {DEFAULT_WORKERS};
+    // Modelo de tiempo de trabajo por estación, con la misma regla
+    std::vector<ServiceModel> service = {service_default()};
+    bool ordered_output = false;              // entregar en el orden de llegada
+    int backend = BACKEND_SPAWN;              // StationBackend
+    bool auto_ack = false;                    // no esperar el ACK de la GUI (--auto-ack / --observer)
+    double duration_s = 0;                    // duración de la corrida sin GUI (0 = hasta Ctrl+C)
+    int speed_x100 = SPEED_REALTIME_X100;     // escala de tiempo inicial ×100 (--time-scale=0.5)
+    uint64_t seed = 0;                        // semilla de la corrida (0 = elegir una al arrancar)
+    int release_policy = RELEASE_PUSH;        // cuándo entra un producto nuevo a la línea
+    int wip_limit = 0;                        // CONWIP por línea (0 = un producto por trabajador)
+    // Tarjetas kanban por estación, misma regla que workers (0 = una por trabajador)
+    std::vector<int> kanban = {0};
+    // Grafo de la línea: routes[i] son las sucesoras de la estación i
+    // (índices dentro de la línea, siempre mayores que i). Vacío = cadena
+    // lineal i → i+1; con --route, las estaciones sin sucesoras son salidas.
+    std::vector<std::vector<int>> routes;
+
+    int bufferAt(int station) const {
+        return station < (int)buffer_depth.size() ? buffer_depth[station] : buffer_depth.back();
+    }
+    int workersAt(int station) const {
+        return station < (int)workers.size() ? workers[station] : workers.back();
+    }
+    const ServiceModel &serviceAt(int station) const {
+        return station < (int)service.size() ? service[station] : service.back();
+    }
+    int kanbanAt(int station) const {
+        int cards = station < (int)kanban.size() ? kanban[station] : kanban.back();
+        return cards > 0 ? cards : workersAt(station);
+    }
+    std::vector<int> routesAt(int station) const {
+        if (!routes.empty()) return station < (int)routes.size() ? routes[station] : std::vector<int>();
+        if (station + 1 < stations) return {station + 1};
+        return {};
+    }
+    int wipLimit() const {
+        if (wip_limit > 0) return wip_limit;
+        int total = 0;
+        for (int i = 0; i < stations; i++) total += workersAt(i);
+        return total;
+    }
+};
+
+// Lee opciones del estilo "--lines=N", "--stations=N", "--buffer=0,2,1",
+// "--policy=rr|jsq|least", "--workers=1,3,1", "--service=MODELO,MODELO..."
+// (p. ej. "fixed:900,normal:1200:150,empirical:ciclos.txt"), "--ordered",
+// "--backend=spawn|fork|thread", "--auto-ack" (u "--observer"),
+// "--duration=SEG", "--time-scale=F" (0.01 a 100), "--seed=N",
+// "--release=push|conwip|kanban", "--wip=N" (tope CONWIP), "--kanban=2,1,3"
+// (tarjetas por estación) o "--route=1:2,2:3,3:4,3:5" (aristas del grafo,
+// estaciones desde 1: la 3 alimenta a la 4 y a la 5). Las opciones desconocidas se ignoran (Qt también
+// recibe argc/argv).
+void parse_sim_args(int argc, char *argv[], SimConfig &cfg);
+
+// Semilla nueva (distinta de 0) para las corridas sin --seed
+uint64_t sim_random_seed();
+
+#endif // SIM_CONFIG_H
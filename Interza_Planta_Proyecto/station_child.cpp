@@ -2,148 +2,264 @@
 #include "ipc_common.h"
 
 #include <unistd.h>
-#include <sys/mman.h>
-#include <sys/stat.h>
-#include <fcntl.h>
 #include <cstdlib>
 #include <cstdio>
 #include <signal.h>
 #include <time.h>
-#include <semaphore.h>
 
-extern "C" void _child_entry(int idx, int seed) {
-    if (!open_ipc()) {
-        fprintf(stderr, "Child %d: cannot open ipc\n", idx);
-        _exit(1);
+// Simula el trabajo de la estación durante ns nanosegundos de simulación.
+// Duerme sobre la palabra de pausa: wakeLine() la despierta al detener y el
+// trabajador sale sin terminar la espera (el backend de hilos no puede
+// matarlo con SIGKILL); ipc_set_speed() también, y lo que falta se
+// recalcula con la nueva escala.
+static void work_for(const ShmState* s, const LineBlock* ln, StationBlock* station, uint64_t ns) {
+    uint64_t last = ipc_now_ns();
+    while (s->header.running && ln->running && ns > 0) {
+        uint64_t speed = (uint64_t)s->header.speed_x100.load();
+        futex_wait_word_for(&station->paused, station->paused.load(), ns * 100 / speed + 1);
+        uint64_t now = ipc_now_ns();
+        uint64_t done = (now - last) * speed / 100;
+        last = now;
+        ns = done < ns ? ns - done : 0;
     }
+}
 
-    int fd = shm_open(SHM_NAME, O_RDWR, 0666);
-    if (fd == -1) { perror("child shm_open"); _exit(1); }
-    ShmState* s = (ShmState*)mmap(NULL, sizeof(ShmState), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
-    ::close(fd);
-    if (s == MAP_FAILED) { perror("child mmap"); _exit(1); }
-
-    sem_t* sem_stage = open_sem_stage(idx);
-    sem_t* sem_ack   = open_sem_ack(idx);
-    sem_t* sem_trans = open_sem_transition();
+// El producto salió de la estación: su tarjeta kanban vuelve a quedar libre,
+// salvo que se deba (se restauró un producto por encima del límite)
+static void release_card(ShmState* s, StationBlock* station, int idx) {
+    int32_t owed = station->cards_owed.load();
+    while (owed > 0) {
+        if (station->cards_owed.compare_exchange_weak(owed, owed - 1)) return;
+    }
+    fsem_post(&station->card_sem);
+    if (idx == 0) ipc_wake_dispatcher(s);
+}
 
-    srand(seed ^ idx);
+// Intenta reservar lugar (y tarjeta, con kanban) en next sin bloquear
+static bool try_reserve(StationBlock* next, int release) {
+    if (release == RELEASE_KANBAN) {
+        if (!fsem_try_wait(&next->card_sem)) return false;
+        if (!fsem_try_wait(&next->space_sem)) {
+            fsem_post(&next->card_sem);
+            return false;
+        }
+        return true;
+    }
+    return fsem_try_wait(&next->space_sem);
+}
 
-    while (s->running) {
-        if (sem_stage) {
-            sem_wait(sem_stage);
-        } else {
-            usleep(100000);
-            continue;
+// Elige la sucesora de un producto que sale de station. Con una sola ruta
+// es directa; en una bifurcación reparte por turnos y, si la del turno está
+// llena, prueba las demás (a lo sumo MAX_ROUTES, sin recorrer el grafo).
+// *reserved indica si ya se tomó el lugar; si ninguna tenía, hay que
+// esperar en la del turno.
+static int route_next(ShmState* s, int line, StationBlock* station, int release, bool* reserved) {
+    *reserved = false;
+    int n = station->route_count;
+    if (n == 1) return station->routes[0];
+    uint32_t turn = station->route_turn.fetch_add(1, std::memory_order_relaxed);
+    for (int k = 0; k < n; k++) {
+        int to = station->routes[(turn + k) % n];
+        if (try_reserve(&s->station(line, to), release)) {
+            *reserved = true;
+            return to;
         }
+    }
+    return station->routes[turn % n];
+}
+
+void station_run(int line, int idx, int worker) {
+    ShmState* s = ipc_state();
+
+    // Bloques de esta línea: la estación solo ve a sus vecinas de la misma línea
+    StationBlock* station = &s->station(line, idx);
+    LineBlock* ln = &s->line(line);
+    WorkerSlot* self = &station->workers[worker];
+
+    FutexSem* sem_stage = &station->stage_sem;
+    FutexSem* sem_ack   = &self->ack_sem;
+    StationLock* lock = &self->lock;
+    bool ordered = s->header.ordered_output != 0;
+    int release = s->header.release_policy;
+    // Sin buffer el lugar en la cola lo da un trabajador libre: ofrece su
+    // crédito al quedar libre y no lo devuelve al sacar el producto
+    bool direct = station->buffer_depth == 0;
+    bool offered = false;
+
+    // Generador propio, en la memoria compartida para que la GUI lo guarde;
+    // si viene restaurado del archivo de estado se sigue desde ahí. Se
+    // escribe con el seqlock del slot tomado: ipc_snapshot lo copia entero.
+    ServiceRng* rng = &station->rngs[worker].rng;
+    const uint64_t* rs = rng->s;
+    if (!(rs[0] | rs[1] | rs[2] | rs[3])) {
+        station_lock(lock);
+        service_rng_stream(rng, s->header.run_seed,
+                           rng_stream_id(line * s->header.station_count + idx, worker));
+        station_unlock(lock);
+    }
 
-        if (!s->running) break;
-        if (s->station_paused[idx]) continue;
+    auto running = [&]() { return s->header.running && ln->running; };
+
+    while (running()) {
+        // Pausa: dormir hasta que resumeStation() o stopAllLines() despierten
+        while (station->paused.load() && running()) {
+            futex_wait_word(&station->paused, 1);
+        }
+        if (!running()) break;
 
         ProductInfo currentProduct;
         currentProduct.productId = 0;
+        uint64_t ticket = 0;
+        bool hasTicket = false;  // los productos restaurados en el slot no tienen turno
 
         // *** FASE 1: ADQUIRIR PRODUCTO ***
-        bool productAcquired = false;
-        int retryCount = 0;
-        const int MAX_RETRIES = 10;
-
-        while (!productAcquired && retryCount < MAX_RETRIES) {
-            if (sem_trans) sem_wait(sem_trans);
-
-            if (idx == 0) {
-                // Estación 0: verificar si slot está vacío
-                if (s->product_in_station[0].productId == 0) {
-                    currentProduct.productId = s->next_product_id++;
-                    s->product_in_station[idx] = currentProduct;
-                    productAcquired = true;
-                }
-            } else {
-                // Otras estaciones: intentar copiar de estación anterior
-                currentProduct = s->product_in_station[idx - 1];
-
-                if (currentProduct.productId > 0) {
-                    s->product_in_station[idx] = currentProduct;
-                    s->product_in_station[idx - 1].productId = 0;
-                    productAcquired = true;
-                }
+        if (self->product.productId > 0) {
+            // Producto restaurado desde el archivo de estado: reprocesarlo
+            currentProduct = self->product;
+        } else {
+            if (direct && !offered) {
+                offered = true;
+                fsem_post(&station->space_sem);
+                if (idx == 0) ipc_wake_dispatcher(s);
             }
 
-            if (sem_trans) sem_post(sem_trans);
+            // Esperar a que la estación anterior (o el despachador, en la
+            // estación 0) encole un producto; lo toma el primer trabajador libre
+            fsem_wait(sem_stage);
+            if (!running()) break;
 
-            if (!productAcquired) {
-                retryCount++;
-                usleep(50000);  // Esperar 50ms antes de reintentar
+            // Pausada mientras esperaba: devolver la señal (el producto, si
+            // lo hay, queda en la cola hasta reanudar) y retirar el crédito
+            // ofrecido sin buffer, para no recibir nada mientras dure la pausa
+            if (station->paused.load()) {
+                fsem_post(sem_stage);
+                if (direct && offered && fsem_try_wait(&station->space_sem)) offered = false;
+                continue;
             }
-        }
 
-        if (!productAcquired || currentProduct.productId <= 0) {
-            // No se pudo adquirir producto después de reintentos
-            continue;
+            // Sacar de la cola y ocupar el slot en una sola sección: los
+            // observadores nunca ven el producto en ambos lugares ni en ninguno
+            station_lock(lock);
+            bool popped = ring_pop(&station->input, &currentProduct, &ticket);
+            if (popped) self->product = currentProduct;
+            station_unlock(lock);
+
+            if (!popped) {
+                // Señal sin producto en la cola (p. ej. al detener)
+                continue;
+            }
+            hasTicket = true;
+            if (direct) {
+                offered = false;  // el crédito ofrecido trajo este producto
+            } else {
+                // Lugar liberado en la cola: devolver el crédito al productor
+                fsem_post(&station->space_sem);
+                if (idx == 0) ipc_wake_dispatcher(s);
+            }
         }
+        journal_append(&s->journal, EV_ACQUIRED, line, idx, currentProduct.productId, worker);
 
         // *** FASE 2: PROCESAR PRODUCTO ***
-        int work_ms = 800 + (rand() % 800);
-        usleep(work_ms * 1000);
+        journal_append(&s->journal, EV_STARTED, line, idx, currentProduct.productId, worker);
+        ipc_notify();
+        uint64_t cycleStart = ipc_now_ns();
+        station_lock(lock);
+        double work_ms = service_sample_ms(station->service, rng);
+        station_unlock(lock);
+        work_for(s, ln, station, (uint64_t)(work_ms * 1e6));
+        if (!running()) break;
 
         // *** FASE 3: MARCAR COMO TERMINADO ***
-        bool markSuccess = false;
-        if (sem_trans) sem_wait(sem_trans);
+        // Solo este trabajador escribe su slot: el producto no puede cambiar
+        station_lock(lock);
+        self->done = 1;
+        station_unlock(lock);
+        journal_append(&s->journal, EV_DONE, line, idx, currentProduct.productId, worker);
+        ipc_notify();  // la GUI debe animar y enviar el ACK
 
-        if (s->product_in_station[idx].productId == currentProduct.productId) {
-            s->station_done[idx] = 1;
-            markSuccess = true;
+        // *** FASE 4: ESPERAR ACK DE LA GUI ***
+        // Sin GUI que anime (auto_ack) el producto sigue de inmediato
+        if (!s->header.auto_ack) {
+            fsem_wait(sem_ack);
+            if (!running()) break;
         }
 
-        if (sem_trans) sem_post(sem_trans);
+        // Tiempo de ciclo del trabajador (trabajo + ACK), media móvil 1/8:
+        // el despachador lo usa para estimar la carga de la línea
+        int64_t cycle = (int64_t)(ipc_now_ns() - cycleStart);
+        int64_t ewma = (int64_t)self->cycle_ewma_ns.load(std::memory_order_relaxed);
+        self->cycle_ewma_ns.store(ewma ? (uint64_t)(ewma + (cycle - ewma) / 8) : (uint64_t)cycle,
+                                  std::memory_order_relaxed);
 
-        if (!markSuccess) {
-            // Producto fue sobrescrito durante el procesamiento
-            continue;
+        // Salida ordenada: esperar a que salgan los productos que llegaron antes
+        bool inTurn = ordered && hasTicket;
+        if (inTurn) {
+            int32_t turn;
+            while ((turn = station->out_turn.load()) != (int32_t)ticket && running()) {
+                futex_wait_word(&station->out_turn, turn);
+            }
+            if (!running()) break;
         }
 
-        // *** FASE 4: ESPERAR ACK DE LA GUI ***
-        if (sem_ack) sem_wait(sem_ack);
-
-        // *** FASE 5: TRANSFERIR A SIGUIENTE ESTACIÓN ***
-        if (idx + 1 < NUM_STATIONS) {
-            // Verificar que el producto aún está presente
-            bool canTransfer = false;
-            if (sem_trans) sem_wait(sem_trans);
-
-            if (s->product_in_station[idx].productId == currentProduct.productId) {
-                canTransfer = true;
+        // *** FASE 5: TRANSFERIR A LA ESTACIÓN SIGUIENTE (según las rutas) ***
+        if (station->route_count > 0) {
+            bool reserved;
+            int to = route_next(s, line, station, release, &reserved);
+            StationBlock* next = &s->station(line, to);
+            if (!reserved) {
+                // Con kanban, primero una tarjeta de la estación siguiente: el
+                // producto queda acá (bloqueando al trabajador) hasta que la haya
+                if (release == RELEASE_KANBAN) {
+                    fsem_wait(&next->card_sem);
+                    if (!running()) break;
+                }
+                // Reservar lugar en la cola siguiente (bloquea solo si está llena)
+                fsem_wait(&next->space_sem);
+                if (!running()) break;
             }
 
-            if (sem_trans) sem_post(sem_trans);
+            // A la bitácora antes de encolarlo, como el despachador: la
+            // llegada siempre precede al EV_ACQUIRED de la estación siguiente
+            journal_append(&s->journal, EV_TRANSFERRED, line, idx, currentProduct.productId, worker, to);
+            station_lock(lock);
+            ring_push(&next->input, currentProduct);
+            self->done = 0;
+            self->product.productId = 0;
+            station_unlock(lock);
 
-            if (canTransfer) {
-                sem_t* next = open_sem_stage(idx + 1);
-                if (next) {
-                    sem_post(next);
-                    // CRÍTICO: Esperar tiempo suficiente para que la siguiente estación copie
-                    // Con 5 productos en paralelo, necesitamos más tiempo
-                    usleep(250000);  // 250ms - tiempo generoso para la copia
-                }
-            }
+            // Avisar explícitamente a la siguiente estación
+            fsem_post(&next->stage_sem);
         } else {
-            // Última estación: limpiar su propio slot
-            if (sem_trans) sem_wait(sem_trans);
-            s->product_in_station[idx].productId = 0;
-            if (sem_trans) sem_post(sem_trans);
+            // Estación de salida: limpiar su propio slot
+            station_lock(lock);
+            self->done = 0;
+            self->product.productId = 0;
+            station_unlock(lock);
+            ln->wip.fetch_sub(1);
+            ln->completed.fetch_add(1);
+            journal_append(&s->journal, EV_COMPLETED, line, idx, currentProduct.productId, worker);
+            // CONWIP: la salida de un producto deja entrar otro
+            if (release == RELEASE_CONWIP) ipc_wake_dispatcher(s);
         }
+        if (release == RELEASE_KANBAN) release_card(s, station, idx);
 
-        // *** FASE 6: AUTO-SEÑAL PARA ESTACIÓN 0 ***
-        if (idx == 0) {
-            // Delay más largo para evitar saturar el pipeline
-            usleep(400000);  // 400ms - controlar tasa de producción
-            if (!s->station_paused[idx] && s->running) {
-                if (sem_stage) sem_post(sem_stage);
-            }
+        if (inTurn) {
+            station->out_turn.fetch_add(1);
+            futex_wake_word(&station->out_turn);
         }
+        ipc_notify();
     }
+}
+
+extern "C" void _child_entry(int line, int idx, int worker) {
+    if (!open_ipc()) {
+        fprintf(stderr, "Child %d/%d/%d: cannot open ipc\n", line, idx, worker);
+        _exit(1);
+    }
+
+    // Mapeo heredado del padre en fork(); no se vuelve a mapear
+    station_run(line, idx, worker);
 
-    if (sem_trans) sem_close(sem_trans);
-    munmap(s, sizeof(ShmState));
+    close_ipc();
     _exit(0);
 }
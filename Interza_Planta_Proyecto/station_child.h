@@ -1,6 +1,13 @@
 #ifndef STATION_CHILD_H
 #define STATION_CHILD_H
 
-extern "C" void _child_entry(int idx, int seed);
+// Ciclo de un trabajador de estación sobre la IPC ya abierta; vuelve cuando
+// la línea o la simulación se detienen. Lo usan tanto el proceso hijo como
+// el backend de hilos. Los tiempos de trabajo salen del flujo propio del
+// trabajador (run_seed de la cabecera), sin semilla por proceso.
+void station_run(int line, int idx, int worker);
+
+// Punto de entrada del proceso hijo (backend fork): station_run y _exit
+extern "C" void _child_entry(int line, int idx, int worker);
 
 #endif // STATION_CHILD_H
@@ -0,0 +1,55 @@
+#include "ipc_common.h"
+#include "station_child.h"
+#include "dispatcher.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Proceso de estación lanzado por ProductionController con posix_spawn:
+//   station --line=L --station=I --worker=W --shm=NOMBRE
+//           --notify-fd=N --id-fd=N
+//   station --dispatcher --shm=NOMBRE --notify-fd=N --id-fd=N
+// Los descriptores llegan ya abiertos (dup2 en el spawn).
+static const char* arg_value(const char* arg, const char* name) {
+    size_t len = strlen(name);
+    if (strncmp(arg, name, len) == 0 && arg[len] == '=') return arg + len + 1;
+    return nullptr;
+}
+
+int main(int argc, char* argv[]) {
+    int line = 0, idx = 0, worker = 0;
+    int notifyFd = -1, idFd = -1;
+    bool dispatcher = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char* v = nullptr;
+        if ((v = arg_value(argv[i], "--line"))) line = atoi(v);
+        else if ((v = arg_value(argv[i], "--station"))) idx = atoi(v);
+        else if ((v = arg_value(argv[i], "--worker"))) worker = atoi(v);
+        else if ((v = arg_value(argv[i], "--shm"))) ipc_set_name(v);
+        else if ((v = arg_value(argv[i], "--notify-fd"))) notifyFd = atoi(v);
+        else if ((v = arg_value(argv[i], "--id-fd"))) idFd = atoi(v);
+        else if (strcmp(argv[i], "--dispatcher") == 0) dispatcher = true;
+    }
+
+    ipc_adopt_fds(notifyFd, idFd);
+    if (!open_ipc()) {
+        fprintf(stderr, "station: cannot open ipc %s\n", ipc_name());
+        return 1;
+    }
+
+    ShmState* s = ipc_state();
+    if (!dispatcher && (line < 0 || line >= s->header.line_count || idx < 0 ||
+                        idx >= s->header.station_count || worker < 0 || worker >= MAX_WORKERS)) {
+        fprintf(stderr, "station: invalid position %d/%d/%d\n", line, idx, worker);
+        close_ipc();
+        return 1;
+    }
+
+    if (dispatcher) dispatcher_run();
+    else station_run(line, idx, worker);
+
+    close_ipc();
+    return 0;
+}
@@ -2,10 +2,33 @@
 #include "ipc_common.h"
 #include <QDebug>
 #include <QThread>
-#include <sys/mman.h>
-#include <fcntl.h>
-#include <unistd.h>
 #include <QDateTime>
+#include <QStringList>
+#include <QHash>
+#include <QElapsedTimer>
+
+// Duerme ms milisegundos, pero vacía la bitácora con drain cada vez que las
+// estaciones escriben JOURNAL_WAKE_EVERY entradas: a velocidad alta o con
+// muchas líneas el anillo da la vuelta en menos de un segundo
+template <class Drain>
+static void sleep_draining(qint64 ms, Drain drain)
+{
+    QElapsedTimer timer;
+    timer.start();
+    for (;;) {
+        qint64 left = ms - timer.elapsed();
+        ShmState* s = ipc_state();
+        if (!s) {
+            if (left > 0) QThread::msleep(left);
+            return;
+        }
+        // Generación leída antes de vaciar: un aviso posterior no se pierde
+        int32_t gen = s->journal.fill_wake.load(std::memory_order_acquire);
+        drain();
+        if (left <= 0) return;
+        journal_wait(&s->journal, gen, (quint64)left * 1000000);
+    }
+}
 
 // ============================================================================
 // CleanThread - Limpieza periódica del sistema
@@ -42,19 +65,17 @@ void CleanThread::run()
         // Simular limpieza de recursos temporales
         emit logMessage(QString("   → Verificando recursos de memoria compartida..."));
 
-        int fd = shm_open(SHM_NAME, O_RDWR, 0666);
-        if (fd != -1) {
-            ShmState* s = (ShmState*)mmap(NULL, sizeof(ShmState), PROT_READ, MAP_SHARED, fd, 0);
-            if (s != MAP_FAILED) {
-                int activeStations = 0;
-                for (int i = 0; i < NUM_STATIONS; i++) {
-                    if (s->product_in_station[i].productId > 0) activeStations++;
-                }
-                emit logMessage(QString("   → Estado: %1 estaciones con productos activos")
-                                    .arg(activeStations));
-                munmap(s, sizeof(ShmState));
+        ShmState* s = ipc_state();
+        if (s) {
+            ShmSnapshot snap;
+            ipc_snapshot(s, &snap);
+
+            int activeStations = 0;
+            for (int i = 0; i < snap.total_stations; i++) {
+                if (snap.busy_workers(i) > 0) activeStations++;
             }
-            ::close(fd);
+            emit logMessage(QString("   → Estado: %1 estaciones con productos activos")
+                                .arg(activeStations));
         }
 
         emit logMessage(QString("   ✓ Limpieza #%1 completada - Sistema optimizado").arg(cycle));
@@ -81,10 +102,29 @@ void LogsThread::run()
     emit logMessage("📋 GeneralLogs: INICIADO - Recopilación de información activa");
 
     int reportCount = 0;
+
+    // Cursor propio en la bitácora; se vacía cada segundo y cada vez que se
+    // llena un cuarto (sleep_draining) para no perder eventos
+    JournalCursor cursor;
+    quint64 eventCounts[EV_LAST + 1] = {0};
+    auto drainJournal = [&]() {
+        ShmState* s = ipc_state();
+        if (!s) return;
+        JournalRecord events[256];
+        int n;
+        while ((n = journal_read(&s->journal, &cursor, events, 256)) > 0) {
+            for (int k = 0; k < n; k++) {
+                if (events[k].type >= EV_ACQUIRED && events[k].type <= EV_LAST) {
+                    eventCounts[events[k].type]++;
+                }
+            }
+        }
+    };
+
     while (running.loadAcquire()) {
         // Reportar cada 45 segundos
         for (int i = 0; i < 45 && running.loadAcquire(); ++i) {
-            QThread::msleep(1000);
+            sleep_draining(1000, drainJournal);
         }
 
         if (!running.loadAcquire()) break;
@@ -95,22 +135,27 @@ void LogsThread::run()
         emit logMessage(QString("📋 GeneralLogs [%1]: Generando reporte del sistema #%2")
                             .arg(timestamp).arg(reportCount));
 
-        int fd = shm_open(SHM_NAME, O_RDWR, 0666);
-        if (fd != -1) {
-            ShmState* s = (ShmState*)mmap(NULL, sizeof(ShmState), PROT_READ, MAP_SHARED, fd, 0);
-            if (s != MAP_FAILED) {
-                emit logMessage(QString("   → Sistema: %1").arg(s->running ? "ACTIVO" : "DETENIDO"));
-                emit logMessage(QString("   → Próximo ID de producto: %1").arg(s->next_product_id));
+        ShmState* s = ipc_state();
+        if (s) {
+            ShmSnapshot snap;
+            ipc_snapshot(s, &snap);
 
-                int paused = 0;
-                for (int i = 0; i < NUM_STATIONS; i++) {
-                    if (s->station_paused[i]) paused++;
-                }
-                emit logMessage(QString("   → Estaciones pausadas: %1/%2").arg(paused).arg(NUM_STATIONS));
+            emit logMessage(QString("   → Sistema: %1").arg(snap.running ? "ACTIVO" : "DETENIDO"));
+            emit logMessage(QString("   → Marca alta de IDs: %1").arg(snap.next_product_id));
+
+            int paused = 0;
+            for (int i = 0; i < snap.total_stations; i++) {
+                if (snap.station_paused[i]) paused++;
+            }
+            emit logMessage(QString("   → Estaciones pausadas: %1/%2").arg(paused).arg(snap.total_stations));
 
-                munmap(s, sizeof(ShmState));
+            QStringList counts;
+            for (int t = EV_ACQUIRED; t <= EV_LAST; t++) {
+                counts << QString("%1 %2").arg(journal_event_name(t)).arg(eventCounts[t]);
+                eventCounts[t] = 0;
             }
-            ::close(fd);
+            emit logMessage(QString("   → Eventos desde el último reporte: %1 (perdidos: %2)")
+                                .arg(counts.join(", ")).arg(cursor.lost));
         }
 
         emit logMessage(QString("   ✓ Reporte #%1 completado").arg(reportCount));
@@ -137,10 +182,52 @@ void StatsThread::run()
     emit logMessage("📊 GeneralStats: INICIADO - Monitoreo de estadísticas activo");
 
     int updateCount = 0;
+
+    // Throughput y tiempo de ciclo a partir de la bitácora (cursor propio)
+    JournalCursor cursor;
+    quint64 lostReported = 0;
+    QHash<qint64, quint64> enteredAt;  // productId -> instante en que se despachó
+    quint64 completed = 0;
+    quint64 leadTimeSumNs = 0;
+    QHash<int, quint64> completedPerLine;  // línea -> completados en el intervalo
+    // WIP de todas las líneas muestreado cada segundo: con el throughput
+    // muestra cuánto inventario necesita la política de liberación
+    quint64 wipSum = 0;
+    int wipSamples = 0;
+    auto sampleWip = [&]() {
+        ShmState* s = ipc_state();
+        if (!s) return;
+        for (int l = 0; l < s->header.line_count; l++) wipSum += qMax(0, (int)s->line(l).wip.load());
+        wipSamples++;
+    };
+    auto drainJournal = [&]() {
+        ShmState* s = ipc_state();
+        if (!s) return;
+        JournalRecord events[256];
+        int n;
+        while ((n = journal_read(&s->journal, &cursor, events, 256)) > 0) {
+            for (int k = 0; k < n; k++) {
+                const JournalRecord &ev = events[k];
+                if (ev.type == EV_DISPATCHED) {
+                    enteredAt.insert(ev.productId, ev.timestamp_ns);
+                } else if (ev.type == EV_COMPLETED) {
+                    completed++;
+                    completedPerLine[ev.line]++;
+                    auto it = enteredAt.find(ev.productId);
+                    if (it != enteredAt.end()) {
+                        leadTimeSumNs += ev.timestamp_ns - it.value();
+                        enteredAt.erase(it);
+                    }
+                }
+            }
+        }
+    };
+
     while (running.loadAcquire()) {
         // Actualizar cada 30 segundos
         for (int i = 0; i < 30 && running.loadAcquire(); ++i) {
-            QThread::msleep(1000);
+            sleep_draining(1000, drainJournal);
+            sampleWip();
         }
 
         if (!running.loadAcquire()) break;
@@ -151,31 +238,107 @@ void StatsThread::run()
         emit logMessage(QString("📊 GeneralStats [%1]: Actualizando estadísticas #%2")
                             .arg(timestamp).arg(updateCount));
 
-        int fd = shm_open(SHM_NAME, O_RDWR, 0666);
-        if (fd != -1) {
-            ShmState* s = (ShmState*)mmap(NULL, sizeof(ShmState), PROT_READ, MAP_SHARED, fd, 0);
-            if (s != MAP_FAILED) {
-                int productsInProgress = 0;
-                int activeStations = 0;
-
-                for (int i = 0; i < NUM_STATIONS; i++) {
-                    if (s->product_in_station[i].productId > 0) {
-                        productsInProgress++;
-                        activeStations++;
-                    }
-                }
-
-                int resourcesUsed = activeStations + (s->running ? 1 : 0);
+        ShmState* s = ipc_state();
+        if (s) {
+            ShmSnapshot snap;
+            ipc_snapshot(s, &snap);
 
-                emit statsUpdated(s->next_product_id - 1, activeStations, resourcesUsed);
+            int productsInProgress = 0;
+            int activeStations = 0;
 
-                emit logMessage(QString("   → Productos en proceso: %1").arg(productsInProgress));
-                emit logMessage(QString("   → Estaciones activas: %1/%2").arg(activeStations).arg(NUM_STATIONS));
-                emit logMessage(QString("   → Recursos en uso: %1").arg(resourcesUsed));
+            for (int i = 0; i < snap.total_stations; i++) {
+                int busy = snap.busy_workers(i);
+                productsInProgress += busy;
+                if (busy > 0) activeStations++;
+                productsInProgress += snap.queued[i];
+            }
 
-                munmap(s, sizeof(ShmState));
+            int resourcesUsed = activeStations + (snap.running ? 1 : 0);
+
+            quint64 dispatched = 0;
+            for (int l = 0; l < snap.line_count; l++) dispatched += snap.line_dispatched[l];
+            emit statsUpdated((int)dispatched, activeStations, resourcesUsed);
+
+            emit logMessage(QString("   → Productos en proceso: %1").arg(productsInProgress));
+            emit logMessage(QString("   → Estaciones activas: %1/%2").arg(activeStations).arg(snap.total_stations));
+            emit logMessage(QString("   → Recursos en uso: %1").arg(resourcesUsed));
+
+            double avgLeadS = completed ? (leadTimeSumNs / 1e9) / completed : 0.0;
+            emit logMessage(QString("   → Completados en el intervalo: %1 (%2/min) | Tiempo en línea promedio: %3 s")
+                                .arg(completed)
+                                .arg(completed * 2)
+                                .arg(avgLeadS, 0, 'f', 2));
+            // Sin esas entradas el throughput y el tiempo en línea quedan cortos
+            if (cursor.lost > lostReported) {
+                emit logMessage(QString("   ⚠️ Bitácora: %1 eventos sobrescritos antes de leerlos en el intervalo")
+                                    .arg(cursor.lost - lostReported));
+                lostReported = cursor.lost;
+            }
+            if (snap.line_count > 1) {
+                QStringList perLine;
+                for (int l = 0; l < snap.line_count; l++) {
+                    perLine << QString("L%1 %2 (cola %3, WIP %4)%5")
+                                   .arg(l + 1)
+                                   .arg(completedPerLine.value(l))
+                                   .arg(snap.queued[l * snap.station_count])
+                                   .arg(snap.line_wip[l])
+                                   .arg(snap.line_running[l] ? "" : " detenida");
+                }
+                emit logMessage(QString("   → Despacho (%1), completados por línea: %2")
+                                    .arg(dispatch_policy_name(snap.dispatch_policy))
+                                    .arg(perLine.join(" | ")));
+            }
+            double wipMean = wipSamples ? (double)wipSum / wipSamples : 0.0;
+            QString limit = snap.release_policy == RELEASE_CONWIP
+                                ? QString(" (tope %1 por línea)").arg(snap.wip_limit) : QString();
+            emit logMessage(QString("   → Liberación %1: WIP medio %2%3 | throughput %4/min | Little: %5 s en línea")
+                                .arg(release_policy_name(snap.release_policy))
+                                .arg(wipMean, 0, 'f', 1)
+                                .arg(limit)
+                                .arg(completed * 2)
+                                .arg(completed ? wipMean / (completed / 30.0) : 0.0, 0, 'f', 2));
+            wipSum = 0;
+            wipSamples = 0;
+
+            // Ocupación de las colas de entrada (instantánea) frente a su capacidad
+            for (int l = 0; l < snap.line_count; l++) {
+                QStringList buffers;
+                for (int i = 0; i < snap.station_count; i++) {
+                    int g = l * snap.station_count + i;
+                    buffers << (snap.buffer_capacity[g]
+                                    ? QString("E%1 %2/%3").arg(i + 1).arg(snap.queued[g]).arg(snap.buffer_capacity[g])
+                                    : QString("E%1 directa").arg(i + 1));
+                }
+                emit logMessage(QString("   → Buffers%1: %2")
+                                    .arg(snap.line_count > 1 ? QString(" L%1").arg(l + 1) : QString())
+                                    .arg(buffers.join(" | ")));
+            }
+            completed = 0;
+            leadTimeSumNs = 0;
+            completedPerLine.clear();
+
+            // Contención de los candados por estación (suma de sus trabajadores)
+            QStringList waits;
+            for (int i = 0; i < snap.total_stations; i++) {
+                const StationBlock &st = s->station(i);
+                quint64 waitNs = 0, contended = 0, acquired = 0;
+                for (int w = 0; w < st.worker_count; w++) {
+                    const StationLock &l = st.workers[w].lock;
+                    waitNs += l.wait_ns.load(std::memory_order_relaxed);
+                    contended += l.contended.load(std::memory_order_relaxed);
+                    acquired += l.acquired.load(std::memory_order_relaxed);
+                }
+                QString name = snap.line_count > 1
+                                   ? QString("L%1E%2").arg(i / snap.station_count + 1).arg(i % snap.station_count + 1)
+                                   : QString("E%1").arg(i + 1);
+                if (st.worker_count > 1) name += QString("×%1").arg(st.worker_count);
+                waits << QString("%1 %2ms (%3/%4)")
+                             .arg(name)
+                             .arg(waitNs / 1e6, 0, 'f', 2)
+                             .arg(contended)
+                             .arg(acquired);
             }
-            ::close(fd);
+            emit logMessage(QString("   → Espera en sección crítica: %1").arg(waits.join(" | ")));
         }
 
         emit logMessage(QString("   ✓ Estadísticas actualizadas"));
@@ -34,24 +34,29 @@ void TransportBeltWidget::setupWithImage(const QString &resourcePath)
 
 void TransportBeltWidget::startAnimation(int cycles, std::function<void()> onFinished)
 {
-    // CRÍTICO: Detener completamente cualquier animación en progreso
-    if (moveTimer->isActive()) {
-        moveTimer->stop();
-    }
+    // Reemplaza cualquier animación en curso. Sin processEvents(): volver a
+    // entrar al bucle de eventos desde aquí puede despachar otro evento de
+    // la bitácora a mitad de esta llamada
+    moveTimer->stop();
+    paused = false;
+    onFinish = onFinished;
 
-    // Esperar a que el timer termine
-    QCoreApplication::processEvents();
+    const int desired_seconds = 5;  // Duración fija
+    beginTravel(desired_seconds * 1000);
+}
 
-    // Resetear estado
-    totalSteps = 0;
+void TransportBeltWidget::showLatest(int durationMs)
+{
+    // Reemplaza lo que se esté mostrando: sin callback ni processEvents
+    moveTimer->stop();
     paused = false;
     onFinish = nullptr;
+    beginTravel(durationMs);
+}
 
-    // Configurar nueva animación
-    onFinish = onFinished;
-
-    const int desired_seconds = 5;  // Duración fija
-    const int interval_ms = 30;     // Intervalo del timer
+void TransportBeltWidget::beginTravel(int durationMs)
+{
+    const int interval_ms = moveTimer->interval();
 
     // SOLUCIÓN DEFINITIVA: Calcular basado en el ancho REAL actual
     int currentWidth = width();
@@ -60,8 +65,8 @@ void TransportBeltWidget::startAnimation(int cycles, std::function<void()> onFin
     // El producto debe viajar desde -pw hasta currentWidth (salir completamente)
     int totalDistance = currentWidth + pw;
 
-    // Calcular cuántos frames tenemos en 5 segundos
-    int totalFrames = (desired_seconds * 1000) / interval_ms;  // 5000ms / 30ms = ~166 frames
+    // Cuántos frames entran en la duración pedida
+    int totalFrames = qMax(1, durationMs / interval_ms);
 
     // Velocidad necesaria para recorrer totalDistance en totalFrames
     // Redondear hacia ARRIBA para asegurar que llega al final
@@ -74,22 +79,17 @@ void TransportBeltWidget::startAnimation(int cycles, std::function<void()> onFin
 
     // SIEMPRE empezar desde la izquierda (fuera de vista)
     productX = -pw;
+    stepCredit = 0;
 
-    // Debug
-    qDebug() << "Animación Estación - Width:" << currentWidth
-             << "| Distance:" << totalDistance
-             << "| Speed:" << beltSpeed << "px/frame"
-             << "| Steps:" << totalSteps
-             << "| Duración:" << (totalSteps * interval_ms / 1000.0) << "seg";
-
-    // Forzar actualización visual
     update();
-    QCoreApplication::processEvents();
-
-    // Iniciar timer
     moveTimer->start();
 }
 
+void TransportBeltWidget::setTimeScale(double scale)
+{
+    timeScale = qBound(0.01, scale, 100.0);
+}
+
 void TransportBeltWidget::stopAnimation()
 {
     if (moveTimer->isActive()) {
@@ -155,9 +155,14 @@ void TransportBeltWidget::animateStep()
         return;
     }
 
-    // Avanzar el producto
-    productX += beltSpeed;
-    totalSteps--;
+    // Avanzar el producto: con la escala de tiempo cada tick vale timeScale
+    // pasos (varios si se acelera, uno cada tantos ticks si se frena)
+    stepCredit += timeScale;
+    while (stepCredit >= 1.0 && totalSteps > 0) {
+        productX += beltSpeed;
+        totalSteps--;
+        stepCredit -= 1.0;
+    }
 
     // Si terminamos los steps
     if (totalSteps <= 0) {
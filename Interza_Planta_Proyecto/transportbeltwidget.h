@@ -20,6 +20,17 @@ public:
     void startAnimation(int cycles = 1, std::function<void()> onFinished = nullptr);
     void stopAnimation();
 
+    // Modo observador: muestra el último producto recorriendo la banda en
+    // durationMs, descartando el que estuviera en curso (sin callback)
+    void showLatest(int durationMs);
+
+    // true mientras una animación tiene pendiente su callback de fin
+    bool isBusy() const { return onFinish != nullptr; }
+
+    // Escala de tiempo de la simulación (1.0 = tiempo real): las animaciones
+    // en curso y las siguientes avanzan a esa velocidad
+    void setTimeScale(double scale);
+
     // pausa suave de la animación (detiene ticks, mantiene posición)
     void pauseAnimation();
     void resumeAnimation();
@@ -34,6 +45,8 @@ private slots:
     void animateStep();
 
 private:
+    void beginTravel(int durationMs);
+
     QPixmap productPixmap;
     QTimer *moveTimer = nullptr;
     int productX = 0;
@@ -41,6 +54,8 @@ private:
     int totalSteps = 0;
     std::function<void()> onFinish = nullptr;
     bool paused = false;
+    double timeScale = 1.0;
+    double stepCredit = 0;  // pasos acumulados aún no dados
 };
 
 #endif // TRANSPORTBELTWIDGET_H